@@ -0,0 +1 @@
+../src/util/mySlabAlloc.h
\ No newline at end of file
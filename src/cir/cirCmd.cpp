@@ -54,7 +54,7 @@ enum CirCmdState
 static CirCmdState curCmd = CIRINIT;
 
 //----------------------------------------------------------------------
-//    CIRRead <(string fileName)> [-Replace]
+//    CIRRead <(string fileName)> [-Replace][-Threads (int n)]
 //----------------------------------------------------------------------
 CmdExecStatus
 CirReadCmd::exec(const string& option)
@@ -67,12 +67,20 @@ CirReadCmd::exec(const string& option)
       return CmdExec::errorOption(CMD_OPT_MISSING, "");
 
    bool doReplace = false;
+   int nThreads = 0;
    string fileName;
    for (size_t i = 0, n = options.size(); i < n; ++i) {
       if (myStrNCmp("-Replace", options[i], 2) == 0) {
          if (doReplace) return CmdExec::errorOption(CMD_OPT_EXTRA,options[i]);
          doReplace = true;
       }
+      else if (myStrNCmp("-Threads", options[i], 2) == 0) {
+         if (nThreads) return CmdExec::errorOption(CMD_OPT_EXTRA,options[i]);
+         if (++i == n)
+            return CmdExec::errorOption(CMD_OPT_MISSING, options[i-1]);
+         if (!myStr2Int(options[i], nThreads) || nThreads <= 0)
+            return CmdExec::errorOption(CMD_OPT_ILLEGAL, options[i]);
+      }
       else {
          if (fileName.size())
             return CmdExec::errorOption(CMD_OPT_ILLEGAL, options[i]);
@@ -93,7 +101,7 @@ CirReadCmd::exec(const string& option)
    }
    cirMgr = new CirMgr;
 
-   if (!cirMgr->readCircuit(fileName)) {
+   if (!cirMgr->readCircuit(fileName, nThreads ? nThreads : 1)) {
       curCmd = CIRINIT;
       delete cirMgr; cirMgr = 0;
       return CMD_EXEC_ERROR;
@@ -107,7 +115,8 @@ CirReadCmd::exec(const string& option)
 void
 CirReadCmd::usage(ostream& os) const
 {
-   os << "Usage: CIRRead <(string fileName)> [-Replace]" << endl;
+   os << "Usage: CIRRead <(string fileName)> [-Replace][-Threads (int n)]"
+      << endl;
 }
 
 void
@@ -118,7 +127,8 @@ CirReadCmd::help() const
 }
 
 //----------------------------------------------------------------------
-//    CIRPrint [-Summary | -Netlist | -PI | -PO | -FLoating | -FECpairs]
+//    CIRPrint [-Summary | -Netlist | -PI | -PO | -FLoating | -FECpairs
+//              | -Memory]
 //----------------------------------------------------------------------
 CmdExecStatus
 CirPrintCmd::exec(const string& option)
@@ -144,6 +154,8 @@ CirPrintCmd::exec(const string& option)
       cirMgr->printFloatGates();
    else if (myStrNCmp("-FECpairs", token, 4) == 0)
       cirMgr->printFECPairs();
+   else if (myStrNCmp("-Memory", token, 2) == 0)
+      cirMgr->printMemory();
    else
       return CmdExec::errorOption(CMD_OPT_ILLEGAL, token);
 
@@ -154,7 +166,7 @@ void
 CirPrintCmd::usage(ostream& os) const
 {  
    os << "Usage: CIRPrint [-Summary | -Netlist | -PI | -PO | -FLoating "
-      << "| -FECpairs]" << endl;
+      << "| -FECpairs | -Memory]" << endl;
 }
 
 void
@@ -184,7 +196,7 @@ CirGateCmd::exec(const string& option)
 
    int gateId = -1, level = 0;
    bool doFanin = false, doFanout = false;
-   CirGate* thisGate = 0;
+   bool hasGate = false;
    for (size_t i = 0, n = options.size(); i < n; ++i) {
       bool checkLevel = false;
       if (myStrNCmp("-FANIn", options[i], 5) == 0) {
@@ -199,16 +211,16 @@ CirGateCmd::exec(const string& option)
          doFanout = true;
          checkLevel = true;
       }
-      else if (!thisGate) {
+      else if (!hasGate) {
          if (!myStr2Int(options[i], gateId) || gateId < 0)
             return CmdExec::errorOption(CMD_OPT_ILLEGAL, options[i]);
-         thisGate = cirMgr->getGate(gateId);
-         if (!thisGate) {
+         hasGate = cirMgr->isGate(gateId);
+         if (!hasGate) {
             cerr << "Error: Gate(" << gateId << ") not found!!" << endl;
             return CmdExec::errorOption(CMD_OPT_ILLEGAL, options[0]);
          }
       }
-      else if (thisGate)
+      else if (hasGate)
          return CmdExec::errorOption(CMD_OPT_EXTRA, options[i]);
       else
          return CmdExec::errorOption(CMD_OPT_ILLEGAL, options[i]);
@@ -221,17 +233,17 @@ CirGateCmd::exec(const string& option)
       }
    }
 
-   if (!thisGate) {
+   if (!hasGate) {
       cerr << "Error: Gate id is not specified!!" << endl;
       return CmdExec::errorOption(CMD_OPT_MISSING, options.back());
    }
 
    if (doFanin)
-      thisGate->reportFanin(level);
+      cirMgr->reportFanin(gateId, level);
    else if (doFanout)
-      thisGate->reportFanout(level);
+      cirMgr->reportFanout(gateId, level);
    else
-      thisGate->reportGate();
+      cirMgr->reportGate(gateId);
 
    return CMD_EXEC_DONE;
 }
@@ -375,7 +387,8 @@ CirStrashCmd::help() const
 
 //----------------------------------------------------------------------
 //    CIRSIMulate <-Random | -File <string patternFile>>
-//                [-Output (string logFile)]
+//                [-Output (string logFile)] [-Words (int n)]
+//                [-Threads (int n)]
 //----------------------------------------------------------------------
 CmdExecStatus
 CirSimCmd::exec(const string& option)
@@ -390,7 +403,9 @@ CirSimCmd::exec(const string& option)
 
    ifstream patternFile;
    ofstream logFile;
-   bool doRandom = false, doFile = false, doLog = false;
+   string logName;
+   bool doRandom = false, doFile = false, doLog = false, doBinary = false;
+   int nWords = 0, nThreads = 0, seed = -1;
    for (size_t i = 0, n = options.size(); i < n; ++i) {
       if (myStrNCmp("-Random", options[i], 2) == 0) {
          if (doRandom || doFile)
@@ -412,22 +427,64 @@ CirSimCmd::exec(const string& option)
             return CmdExec::errorOption(CMD_OPT_ILLEGAL, options[i]);
          if (++i == n)
             return CmdExec::errorOption(CMD_OPT_MISSING, options[i-1]);
-         logFile.open(options[i].c_str(), ios::out);
-         if (!logFile)
-            return CmdExec::errorOption(CMD_OPT_FOPEN_FAIL, options[i]);
+         logName = options[i];
          doLog = true;
       }
+      else if (myStrNCmp("-Binary", options[i], 2) == 0) {
+         if (doBinary)
+            return CmdExec::errorOption(CMD_OPT_ILLEGAL, options[i]);
+         doBinary = true;
+      }
+      else if (myStrNCmp("-Words", options[i], 2) == 0) {
+         if (nWords)
+            return CmdExec::errorOption(CMD_OPT_ILLEGAL, options[i]);
+         if (++i == n)
+            return CmdExec::errorOption(CMD_OPT_MISSING, options[i-1]);
+         if (!myStr2Int(options[i], nWords) || nWords <= 0)
+            return CmdExec::errorOption(CMD_OPT_ILLEGAL, options[i]);
+      }
+      else if (myStrNCmp("-Seed", options[i], 2) == 0) {
+         if (seed >= 0)
+            return CmdExec::errorOption(CMD_OPT_ILLEGAL, options[i]);
+         if (++i == n)
+            return CmdExec::errorOption(CMD_OPT_MISSING, options[i-1]);
+         if (!myStr2Int(options[i], seed) || seed < 0)
+            return CmdExec::errorOption(CMD_OPT_ILLEGAL, options[i]);
+      }
+      else if (myStrNCmp("-Threads", options[i], 2) == 0) {
+         if (nThreads)
+            return CmdExec::errorOption(CMD_OPT_ILLEGAL, options[i]);
+         if (++i == n)
+            return CmdExec::errorOption(CMD_OPT_MISSING, options[i-1]);
+         if (!myStr2Int(options[i], nThreads) || nThreads <= 0)
+            return CmdExec::errorOption(CMD_OPT_ILLEGAL, options[i]);
+      }
       else
          return CmdExec::errorOption(CMD_OPT_ILLEGAL, options[i]);
    }
 
    if (!doRandom && !doFile)
       return CmdExec::errorOption(CMD_OPT_MISSING, "");
+   if (doBinary && !doLog)
+      return CmdExec::errorOption(CMD_OPT_ILLEGAL, "-Binary");
+   if (seed >= 0 && !doRandom)
+      return CmdExec::errorOption(CMD_OPT_ILLEGAL, "-Seed");
+   if (doLog) {
+      logFile.open(logName.c_str(), doBinary ? ios::out | ios::binary : ios::out);
+      if (!logFile)
+         return CmdExec::errorOption(CMD_OPT_FOPEN_FAIL, logName);
+   }
 
    assert (curCmd != CIRINIT);
    if (doLog)
-      cirMgr->setSimLog(&logFile);
+      cirMgr->setSimLog(&logFile, doBinary);
    else cirMgr->setSimLog(0);
+   if (nWords)
+      cirMgr->setSimWords(nWords);
+   if (nThreads)
+      cirMgr->setSimThreads(nThreads);
+   if (seed >= 0)
+      cirMgr->setSimSeed(seed);
 
    if (doRandom)
       cirMgr->randomSim();
@@ -442,8 +499,9 @@ CirSimCmd::exec(const string& option)
 void
 CirSimCmd::usage(ostream& os) const
 {
-   os << "Usage: CIRSIMulate <-Random | -File <string patternFile>>\n"
-      << "                   [-Output (string logFile)]" << endl;
+   os << "Usage: CIRSIMulate <-Random [-Seed (int n)] | -File <string patternFile>>\n"
+      << "                   [-Output (string logFile) [-Binary]] [-Words (int n)]\n"
+      << "                   [-Threads (int n)]" << endl;
 }
 
 void
@@ -454,7 +512,7 @@ CirSimCmd::help() const
 }
 
 //----------------------------------------------------------------------
-//    CIRFraig
+//    CIRFraig [-Merge] [-Effort (int level)] [-Threads (int n)]
 //----------------------------------------------------------------------
 CmdExecStatus
 CirFraigCmd::exec(const string& option)
@@ -467,14 +525,44 @@ CirFraigCmd::exec(const string& option)
    vector<string> options;
    CmdExec::lexOptions(option, options);
 
-   if (!options.empty())
-      return CmdExec::errorOption(CMD_OPT_EXTRA, options[0]);
+   int nThreads = 0, effort = -1;
+   bool mergeNow = false;
+   for (size_t i = 0, n = options.size(); i < n; ++i) {
+      if (myStrNCmp("-Merge", options[i], 2) == 0) {
+         if (mergeNow)
+            return CmdExec::errorOption(CMD_OPT_ILLEGAL, options[i]);
+         mergeNow = true;
+      }
+      else if (myStrNCmp("-Effort", options[i], 2) == 0) {
+         if (effort >= 0)
+            return CmdExec::errorOption(CMD_OPT_ILLEGAL, options[i]);
+         if (++i == n)
+            return CmdExec::errorOption(CMD_OPT_MISSING, options[i-1]);
+         // level n: up to n tries, from 100 conflicts up to 100 * 4^(n-1)
+         if (!myStr2Int(options[i], effort) || effort < 0 || effort > 16)
+            return CmdExec::errorOption(CMD_OPT_ILLEGAL, options[i]);
+      }
+      else if (myStrNCmp("-Threads", options[i], 2) == 0) {
+         if (nThreads)
+            return CmdExec::errorOption(CMD_OPT_ILLEGAL, options[i]);
+         if (++i == n)
+            return CmdExec::errorOption(CMD_OPT_MISSING, options[i-1]);
+         if (!myStr2Int(options[i], nThreads) || nThreads <= 0)
+            return CmdExec::errorOption(CMD_OPT_ILLEGAL, options[i]);
+      }
+      else
+         return CmdExec::errorOption(CMD_OPT_EXTRA, options[i]);
+   }
 
    if (curCmd != CIRSIMULATE) {
       cerr << "Error: circuit is not yet simulated!!" << endl;
       return CMD_EXEC_ERROR;
    }
-   cirMgr->fraig();
+   if (nThreads)
+      cirMgr->setSimThreads(nThreads);
+   if (effort >= 0)
+      cirMgr->setFraigEffort(effort);
+   cirMgr->fraig(mergeNow);
    curCmd = CIRFRAIG;
 
    return CMD_EXEC_DONE;
@@ -483,7 +571,7 @@ CirFraigCmd::exec(const string& option)
 void
 CirFraigCmd::usage(ostream& os) const
 {
-   os << "Usage: CIRFraig" << endl;
+   os << "Usage: CIRFraig [-Merge] [-Effort (int level)] [-Threads (int n)]" << endl;
 }
 
 void
@@ -494,7 +582,7 @@ CirFraigCmd::help() const
 }
 
 //----------------------------------------------------------------------
-//    CIRWrite [(int gateId)][-Output (string aagFile)]
+//    CIRWrite [(int gateId)][-Output (string aagFile)][-Binary]
 //----------------------------------------------------------------------
 CmdExecStatus
 CirWriteCmd::exec(const string& option)
@@ -511,9 +599,10 @@ CirWriteCmd::exec(const string& option)
       cirMgr->writeAag(cout);
       return CMD_EXEC_DONE;
    }
-   bool hasFile = false;
+   bool hasFile = false, doBinary = false;
    int gateId;
-   CirGate *thisGate = NULL;
+   bool hasGate = false;
+   string fileName;
    ofstream outfile;
    for (size_t i = 0, n = options.size(); i < n; ++i) {
       if (myStrNCmp("-Output", options[i], 2) == 0) {
@@ -521,20 +610,23 @@ CirWriteCmd::exec(const string& option)
             return CmdExec::errorOption(CMD_OPT_EXTRA, options[i]);
          if (++i == n)
             return CmdExec::errorOption(CMD_OPT_MISSING, options[i-1]);
-         outfile.open(options[i].c_str(), ios::out);
-         if (!outfile)
-            return CmdExec::errorOption(CMD_OPT_FOPEN_FAIL, options[1]);
+         fileName = options[i];
          hasFile = true;
       }
+      else if (myStrNCmp("-Binary", options[i], 2) == 0) {
+         if (doBinary)
+            return CmdExec::errorOption(CMD_OPT_EXTRA, options[i]);
+         doBinary = true;
+      }
       else if (myStr2Int(options[i], gateId) && gateId >= 0) {
-         if (thisGate != NULL)
+         if (hasGate)
             return CmdExec::errorOption(CMD_OPT_EXTRA, options[i]);
-         thisGate = cirMgr->getGate(gateId);
-         if (!thisGate) {
+         hasGate = cirMgr->isGate(gateId);
+         if (!hasGate) {
             cerr << "Error: Gate(" << gateId << ") not found!!" << endl;
             return CmdExec::errorOption(CMD_OPT_ILLEGAL, options[i]);
          }
-         if (!thisGate->isAig()) {
+         if (cirMgr->getType(gateId) != AIG_GATE) {
              cerr << "Error: Gate(" << gateId << ") is NOT an AIG!!" << endl;
             return CmdExec::errorOption(CMD_OPT_ILLEGAL, options[i]);
          }
@@ -542,12 +634,21 @@ CirWriteCmd::exec(const string& option)
       else return CmdExec::errorOption(CMD_OPT_ILLEGAL, options[i]);
    }
 
-   if (!thisGate) {
-      assert (hasFile);
-      cirMgr->writeAag(outfile);
+   // a binary AIG goes to a file only
+   if (doBinary && !hasFile)
+      return CmdExec::errorOption(CMD_OPT_ILLEGAL, "-Binary");
+   if (hasFile) {
+      outfile.open(fileName.c_str(), doBinary ? ios::out | ios::binary : ios::out);
+      if (!outfile)
+         return CmdExec::errorOption(CMD_OPT_FOPEN_FAIL, fileName);
    }
-   else if (hasFile) cirMgr->writeGate(outfile, thisGate);
-   else cirMgr->writeGate(cout, thisGate);
+
+   if (!hasGate) {
+      if (hasFile) cirMgr->writeAag(outfile, doBinary);
+      else cirMgr->writeAag(cout, doBinary);
+   }
+   else if (hasFile) cirMgr->writeGate(outfile, gateId, doBinary);
+   else cirMgr->writeGate(cout, gateId, doBinary);
 
    return CMD_EXEC_DONE;
 }
@@ -555,13 +656,14 @@ CirWriteCmd::exec(const string& option)
 void
 CirWriteCmd::usage(ostream& os) const
 {
-   os << "Usage: CIRWrite [(int gateId)][-Output (string aagFile)]" << endl;
+   os << "Usage: CIRWrite [(int gateId)][-Output (string aagFile)][-Binary]"
+      << endl;
 }
 
 void
 CirWriteCmd::help() const
 {
    cout << setw(15) << left << "CIRWrite: "
-        << "write the netlist to an ASCII AIG file (.aag)\n";
+        << "write the netlist to an ASCII (.aag) or binary (.aig) AIG file\n";
 }
 
@@ -16,11 +16,9 @@ using namespace std;
 
 // TODO: define your own typedef or enum
 
-class CirGate;
 class CirMgr;
 class SatSolver;
 
-typedef vector<CirGate*>           GateList;
 typedef vector<unsigned>           IdList;
 typedef unsigned long long         ull;
 
@@ -32,7 +30,7 @@ enum GateType
    AIG_GATE   = 3,
    CONST_GATE = 4,
 
-   TOT_GATE
+   TOT_GATE                // also marks an unused gate ID
 };
 
 #endif // CIR_DEF_H
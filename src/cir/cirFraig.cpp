@@ -7,6 +7,8 @@
 ****************************************************************************/
 
 #include <cassert>
+#include <sstream>
+#include <algorithm>
 #include "cirMgr.h"
 #include "cirGate.h"
 #include "sat.h"
@@ -25,6 +27,50 @@ using namespace std;
 /**************************************/
 /*   Static varaibles and functions   */
 /**************************************/
+// One solver of CirMgr::fraig() and its share of a round
+struct FraigSolver
+{
+   SatSolver*           s;
+   unsigned             index;     // in the solvers of the session
+   vector<Var>          var;       // of each gate, 0 until genProofModel()
+   IdList               ids;       // the members of its groups, in DFS order
+   size_t               next;      // the first of "ids" not done
+   size_t               first;     // its first simulation bit
+   size_t               nBits;     // its simulation bits
+   vector<ull>          pat;       // its bits, word j of PI i at [j * #PIs + i]
+   vector<ull>          care;      // the bits of "pat" that a model set
+   size_t               count;     // counterexamples in "pat", up to nBits
+   size_t               nDropped;  // members left unproved this round
+   bool                 mergeNow;  // merge each proved pair at once
+   vector<unsigned*>    merges;    // as mergeFec() takes them, if not
+   size_t               nMerged;   // if so, with the fanouts moved in
+   IdList               moved;     // "moved"
+   ostringstream        log;       // the proof log, if it runs on a thread
+};
+
+// The conflict budget of try "t" (from 0) of a pair at effort "effort",
+// or -1 for no limit: 100 conflicts, four times as many on each retry
+static int64
+fraigBudget(unsigned effort, unsigned t)
+{
+   return (effort ? int64(100) << (2 * t) : -1);
+}
+
+// Copy "n" pattern bits of each of "nPIs" PIs from bit "from" of "src" to
+// bit "to" of "dst"; word j of PI i is at [j * nPIs + i] in both
+static void
+copyPatBits(const vector<ull>& src, size_t from, vector<ull>& dst, size_t to,
+            size_t n, size_t nPIs)
+{
+   for (size_t b = 0; b < n; b++) {
+      size_t sw = (from + b) / 64 * nPIs, dw = (to + b) / 64 * nPIs;
+      size_t sb = (from + b) % 64, db = (to + b) % 64;
+      for (size_t i = 0; i < nPIs; i++) {
+         ull v = (src[sw + i] >> sb) & 1;
+         dst[dw + i] = (dst[dw + i] & ~(ull(1) << db)) | (v << db);
+      }
+   }
+}
 
 /*******************************************/
 /*   Public member functions about fraig   */
@@ -34,157 +80,364 @@ using namespace std;
 void
 CirMgr::strash()
 {
-   CirGate::setGlobalRef();
-   GateList dfsList;
-   dfsList.reserve(_headerInfo[0] + _headerInfo[3] + 1);
-   for (const auto& id : _POIds)
-      dfsTraversal(_totGates[id], dfsList);
+   const IdList& dfsList = getDfsList();
    
-   HashMap<HashKey, CirGate*> hash(_headerInfo[0] + 1);
-   for (auto& g : dfsList) {
-      if (!g->isAig())
+   HashMap<HashKey, unsigned> hash(_headerInfo[0] + 1);
+   for (auto& id : dfsList) {
+      if (_type[id] != AIG_GATE)
          continue;
       
-      HashKey k(g->getFanin(0).getGateV(), g->getFanin(1).getGateV());
-      CirGate* mergeGate;
-      if (hash.query(k, mergeGate)) {
-         mergeGate->merge(g, 0);
+      HashKey k(getFanin(id, 0).getLit(), getFanin(id, 1).getLit());
+      unsigned mergeId;
+      if (hash.query(k, mergeId)) {
+         merge(AigGateV(mergeId), id);
          _headerInfo[4]--;
-         delete _totGates[g->getGid()];
-         _totGates[g->getGid()] = 0;
-         cout << "Strashing: " << mergeGate->getGid() << " merging " << g->getGid() << "...\n";
+         cout << "Strashing: " << mergeId << " merging " << id << "...\n";
+         deleteGate(id);
       }
       else 
-         hash.insert(k, g);
+         hash.insert(k, id);
    }
-
+   invalidateDfsList();
+   collectFanouts();
 }
 
+// There are 16 solvers whatever the number of threads, and the FEC
+// groups are dealt to them in the DFS order of their first members.
+// Solver k proves the pairs of its groups in DFS order and puts its
+// counterexamples in its own range of the bits of the simulation words
+// (there are 64 at least); it stops when they are full. The solvers are
+// independent, so the simulation threads take them one at a time from
+// the pool. A round goes in waves of DFS positions, and the merges of a
+// wave are added to the other solvers before the next one; the netlist
+// is merged in DFS order. What a solver is given does not depend on the
+// threads, so the output is the same for any number of threads. Only
+// the bits of the counterexamples are written, and only for the PIs that
+// a model set in one of them; the other bits keep the values of earlier
+// patterns. After a round, only the fanout cones of the merged gates and
+// of the PIs that got new values are resimulated, and only the FEC
+// groups with a changed gate are split again.
+// The solvers serve all rounds, so their learnt clauses and activities
+// are kept. A gate is encoded in a solver once, when a proof there first
+// reaches its fanin cone: a merge keeps the function of every gate, so
+// the clauses of the merged gates stay valid, and each proved pair is
+// added as an equivalence instead.
+// With "mergeNow", one solver proves all pairs, bottom-up in DFS order,
+// and fills all simulation words; each proved pair is merged in the
+// netlist at once. The fanouts of a merged gate then use the base gate,
+// so the cones encoded after that share the part already proved and
+// the later miters get smaller.
 void
-CirMgr::fraig()
+CirMgr::fraig(bool mergeNow)
 {
-   GateList dfsList;
-   dfsList.reserve(_headerInfo[0] + _headerInfo[3] + 1);
-   updateDfsList(dfsList);
-
-   while (!_fecGrps.empty()) {
-      size_t count = 0;
-      GateList mergeBase(_fecGrps.size(), 0);
-      if (_totGates[0]->getFecGrpIdx() < _fecGrps.size())
-         mergeBase[_totGates[0]->getFecGrpIdx()] = _totGates[0];
-      vector<unsigned*> mergeList;
-      vector<ull> pat(_PIIds.size(), 0);
-      SatSolver* s = new SatSolver;
-      s->initialize();
-      genProofModel(s, dfsList);
-      for (auto& g : dfsList) {
-         if (g->getType() != AIG_GATE || g->getFecGrpIdx() >= _fecGrps.size())
-            continue;
-         
-         if (mergeBase[g->getFecGrpIdx()] == 0) {
-            mergeBase[g->getFecGrpIdx()] = g;
-            continue;
-         }
+   const IdList& dfsList = getDfsList();
+   size_t nPIs = _PIIds.size(), nBits = 64 * _simWords;
+   size_t nSolvers = (mergeNow ? 1 : 16);
+   vector<FraigSolver> solvers(nSolvers);
+   for (size_t k = 0; k < nSolvers; k++) {
+      FraigSolver& f = solvers[k];
+      f.index = k;
+      f.first = nBits * k / nSolvers;
+      f.nBits = nBits * (k + 1) / nSolvers - f.first;
+      f.mergeNow = mergeNow;
+      f.nMerged = 0;
+      f.s = new SatSolver;
+      f.s->initialize();
+      // variable 0 stands for CONST0 and the undefined gates, which are 0
+      // as in simulation; the other gates get theirs from genProofModel()
+      f.var.assign(_type.size(), 0);
+      f.s->assertProperty(0, false);
+      f.nDropped = 0;
+   }
+   IdList tries(_type.size(), 0);   // undecided proofs of each gate
+   IdList home(_type.size(), 0);    // the solver of the last of them
+   size_t nDropped = 0;
+   // a single solver runs on this thread and logs in order with the
+   // merges that mergeFec() prints
+   bool buffered = (nSolvers > 1 && _simPool.size() > 1);
+
+   while (numFecGrps()) {
+      // UINT_MAX: no base gate yet (gate 0 is CONST0)
+      IdList mergeBase(numFecGrps(), UINT_MAX);
+      if (_fecGrpIdx[0] < numFecGrps())
+         mergeBase[_fecGrpIdx[0]] = 0;
+      IdList cands;
+      for (auto& id : dfsList) {
+         if (_type[id] == AIG_GATE && _fecGrpIdx[id] < numFecGrps())
+            cands.push_back(id);
+      }
+      IdList slot(numFecGrps(), UINT_MAX);
+      size_t nSeen = 0;
+      for (auto& f : solvers) {
+         f.ids.clear();
+         f.next = f.count = 0;
+         f.pat.assign((f.nBits + 63) / 64 * nPIs, 0);
+         f.care.assign(f.pat.size(), 0);
+      }
+      // a group with an undecided member goes back to the solver that
+      // tried it, which keeps what it learnt; a group only splits, so
+      // all such members of a group were tried in the same solver
+      for (auto& id : cands) {
+         if (tries[id])
+            slot[_fecGrpIdx[id]] = home[id];
+      }
+      for (auto& id : cands) {
+         unsigned grpIdx = _fecGrpIdx[id];
+         if (slot[grpIdx] == UINT_MAX)
+            slot[grpIdx] = nSeen++ % nSolvers;
+         solvers[slot[grpIdx]].ids.push_back(id);
+      }
 
-         bool result = proofFec(s, mergeBase[g->getFecGrpIdx()], g);
-         if (result) {
-            for (size_t i = 0; i < _PIIds.size(); i++) {
-               pat[i] |= ull(s->getValue(_totGates[_PIIds[i]]->getVar())) << count;
+      // the merges of a wave are shared before the next one; the other
+      // solvers learn those of gates that they have encoded
+      vector<unsigned*> mergeList;
+      size_t waveSize = (mergeNow ? cands.size() : 32 * nSolvers);
+      for (size_t i = 0; i < cands.size(); i += waveSize) {
+         unsigned end = (i + waveSize < cands.size() ? _dfsPos[cands[i + waveSize]] : UINT_MAX);
+         _simPool.run(nSolvers, [&](size_t k) {
+            proofFecGrps(solvers[k], mergeBase, tries, home, end, buffered ? &solvers[k].log : &cout);
+         });
+         for (auto& f : solvers) {
+            if (buffered) {
+               cout << f.log.str() << flush;
+               f.log.str("");
             }
-            count++;
-            if (_totGates[0]->getFecGrpIdx() != g->getFecGrpIdx())
-               mergeBase[g->getFecGrpIdx()] = g;
+            for (auto& l : f.merges) {
+               AigGateV base = AigGateV::fromLit(l[0]);
+               for (auto& g : solvers) {
+                  if (&g != &f && g.var[base.getGid()] && g.var[l[1]])
+                     g.s->addEqCNF(g.var[base.getGid()], base.isInv(), g.var[l[1]], false);
+               }
+            }
+            mergeList.insert(mergeList.end(), f.merges.begin(), f.merges.end());
+            f.merges.clear();
          }
-         else {
-            IdList* fecGrp = _fecGrps[g->getFecGrpIdx()];
-            auto it = find(fecGrp->begin(), fecGrp->end(), g->getGid());
-            _fecGrps[g->getFecGrpIdx()]->erase(it);
-            mergeList.push_back(new unsigned[2] {mergeBase[g->getFecGrpIdx()]->getGid(), g->getGid()});
+      }
+      size_t count = 0, nMerged = mergeList.size(), dropped = 0;
+      IdList moved, changed;
+      for (auto& f : solvers) {
+         count += f.count;
+         dropped += f.nDropped;
+         f.nDropped = 0;
+         nMerged += f.nMerged;
+         moved.insert(moved.end(), f.moved.begin(), f.moved.end());
+         f.nMerged = 0;
+         f.moved.clear();
+      }
+      sort(mergeList.begin(), mergeList.end(), [&](unsigned* a, unsigned* b) {
+         return _dfsPos[a[1]] < _dfsPos[b[1]];
+      });
+      if (nMerged) {
+         // merging keeps the function of every gate, so the rewired
+         // fanouts are resimulated and normally nothing changes; the
+         // members that left the DFS list are dropped
+         if (!mergeList.empty()) {
+            cout << "\n";
+            mergeFec(mergeList, moved);
          }
-         if ((count & 63) == 0 && count > 0) 
-            break;
-      }
-      if (!mergeList.empty()) {
-         mergeFec(mergeList);
-         updateDfsList(dfsList);
-         for (auto& fecGrp : _fecGrps)
-            fecGrp->clear();
-
-         simulate(dfsList, 64);
-
-         if (_totGates[0]->getFecGrpIdx() < _fecGrps.size())
-            _fecGrps[_totGates[0]->getFecGrpIdx()]->push_back(_totGates[0]->getGid());
-         for (auto& g : dfsList) {
-            if (g->isAig()) {
-               if (g->getFecGrpIdx() < _fecGrps.size())
-                  _fecGrps[g->getFecGrpIdx()]->push_back(g->getGid());
+         getDfsList();
+         resimulate(moved, 1, changed);
+         _lastWord = 0;
+         for (auto& gv : _fecMembers) {
+            if (gv != deadEdge() && _dfsPos[gv.getGid()] == UINT_MAX && gv.getGid() != 0) {
+               _fecGrpIdx[gv.getGid()] = UINT_MAX;
+               gv = deadEdge();
             }
          }
-         identifyFec();
-         setFecGrpIdx();
-         cout << "Updating by UNSAT... Total #FEC Group = " << _fecGrps.size() << "\n";
+         identifyFec(changed);
+         cout << "Updating by UNSAT... Total #FEC Group = " << numFecGrps() << "\n";
       }
 
       if (count) {
-         for (size_t i = 0; i < _PIIds.size(); i++) 
-            _totGates[_PIIds[i]]->setPattern(pat[i]);
-         fill(pat.begin(), pat.end(), 0);
-         simulate(dfsList, count);
-         identifyFec();
-         setFecGrpIdx();
-         count = 0;
-         cout << "Updating by SAT... Total #FEC Group = " << _fecGrps.size() << "\n";
+         // word j of PI i at [j * nPIs + i]; "cex" has the bits of the
+         // counterexamples, for all PIs
+         IdList seeds, changed;
+         vector<ull> pat(_simWords * nPIs, 0), care(pat.size(), 0), cex(_simWords, 0);
+         for (auto& f : solvers) {
+            copyPatBits(f.pat, 0, pat, f.first, f.count, nPIs);
+            copyPatBits(f.care, 0, care, f.first, f.count, nPIs);
+            for (size_t b = f.first; b < f.first + f.count; b++)
+               cex[b / 64] |= ull(1) << (b % 64);
+         }
+         // a PI that no model set keeps its words, so it is not
+         // resimulated; the others get random values in the bits of the
+         // counterexamples that left them free
+         for (size_t i = 0; i < nPIs; i++) {
+            bool inCone = false;
+            for (size_t j = 0; j < _simWords && !inCone; j++)
+               inCone = (care[j * nPIs + i] != 0);
+            if (!inCone)
+               continue;
+            ull* w = getPattern(_PIIds[i]);
+            bool diff = false;
+            for (size_t j = 0; j < _simWords; j++) {
+               ull c = care[j * nPIs + i], left = cex[j] & ~c;
+               ull p = (w[j] & ~cex[j]) | (pat[j * nPIs + i] & c);
+               if (left)
+                  p |= _simRng[0]() & left;
+               if (w[j] != p) {
+                  w[j] = p;
+                  diff = true;
+               }
+            }
+            if (diff)
+               getFanouts(_PIIds[i], seeds);
+         }
+         resimulate(seeds, _simWords, changed);
+         _lastWord = 0;
+         identifyFec(changed);
+         cout << "Updating by SAT... Total #FEC Group = " << numFecGrps() << "\n";
       }
-
-      delete s;
+      else if (!nMerged && dropped) {
+         // only members that ran out of tries left their groups; drop
+         // them, and the groups left with fewer than two, or the next
+         // round finds the same groups again
+         identifyFec(IdList());
+      }
+      nDropped += dropped;
    }
+   for (auto& f : solvers)
+      delete f.s;
+   if (nDropped)
+      cout << "Note: " << nDropped << " FEC members are left unproved at effort "
+           << _fraigEffort << "\n";
 }
 
 /********************************************/
 /*   Private member functions about fraig   */
 /********************************************/
+// Prove the pairs of solver "f" up to (but not including) DFS position
+// "end": each member of a group is proved against the base gate of the
+// group, which becomes the member if they differ (except for CONST0).
+// Stop when the bits of "f" are full of counterexamples; the proof log
+// goes to "os".
+// A member whose proof runs out of budget stays in its group and is tried
+// again in a later round with the next budget, in the same solver
+// ("home"), so the retry resumes with the clauses learnt so far; after
+// _fraigEffort tries it leaves the group unmerged.
 void
-CirMgr::genProofModel(SatSolver*& s, GateList& dfsList)
+CirMgr::proofFecGrps(FraigSolver& f, IdList& mergeBase, IdList& tries, IdList& home, unsigned end, ostream* os)
 {
-   for (auto& g : dfsList) {
-      if (g->getType() == AIG_GATE || g->getType() == PI_GATE || g->getType() == CONST_GATE) {
-         Var v = s->newVar();
-         g->setVar(v);
+   for (; f.next < f.ids.size() && f.count < f.nBits; f.next++) {
+      unsigned id = f.ids[f.next];
+      if (_dfsPos[id] >= end)
+         break;
+      unsigned grpIdx = _fecGrpIdx[id];
+      if (mergeBase[grpIdx] == UINT_MAX) {
+         mergeBase[grpIdx] = id;
+         continue;
+      }
+
+      lbool result = proofFec(f, mergeBase[grpIdx], id, fraigBudget(_fraigEffort, tries[id]), *os);
+      if (result == l_Undef) {
+         home[id] = f.index;
+         if (++tries[id] == _fraigEffort) {
+            _fecMembers[_fecPos[id]] = deadEdge();
+            _fecGrpIdx[id] = UINT_MAX;
+            f.nDropped++;
+         }
+      }
+      else if (result == l_True) {
+         size_t w = (f.count / 64) * _PIIds.size();
+         ull b = ull(1) << (f.count % 64);
+         for (size_t i = 0; i < _PIIds.size(); i++) {
+            // a PI outside the proved cones is left free
+            Var v = f.var[_PIIds[i]];
+            if (v == 0)
+               continue;
+            f.care[w + i] |= b;
+            if (f.s->getValue(v))
+               f.pat[w + i] |= b;
+         }
+         f.count++;
+         if (_fecGrpIdx[0] != grpIdx)
+            mergeBase[grpIdx] = id;
+      }
+      else {
+         unsigned base = mergeBase[grpIdx];
+         AigGateV baseV(base, fecInv(base) != fecInv(id));
+         f.s->addEqCNF(f.var[base], baseV.isInv(), f.var[id], false);
+         _fecMembers[_fecPos[id]] = deadEdge();
+         _fecGrpIdx[id] = UINT_MAX;
+         f.merges.push_back(new unsigned[2] {baseV.getLit(), id});
+         if (f.mergeNow) {
+            // one line apart from the proofs, once a round
+            if (!f.nMerged)
+               cout << "\n";
+            mergeFec(f.merges, f.moved);
+            f.merges.clear();
+            f.nMerged++;
+         }
       }
    }
-   for (auto& g : dfsList) {
-      if (g->getType() == AIG_GATE) {
-         s->addAigCNF(g->getVar(), g->getFanin(0).gate()->getVar(), g->getFanin(0).isInv(), g->getFanin(1).gate()->getVar(), g->getFanin(1).isInv());
+}
+
+// Encode the gates in the fanin cone of "gid" that are not in solver "f"
+// yet, fanins first. A PI or an AIG is not encoded while f.var[gid] == 0.
+void
+CirMgr::genProofModel(FraigSolver& f, unsigned gid)
+{
+   if (f.var[gid])
+      return;
+   vector<pair<unsigned, unsigned> > stack(1, make_pair(gid, 0));
+   while (!stack.empty()) {
+      pair<unsigned, unsigned>& top = stack.back();
+      if (top.second < nFanins(top.first)) {
+         unsigned fanin = getFanin(top.first, top.second++).getGid();
+         if (!f.var[fanin])
+            stack.push_back(make_pair(fanin, 0));
+         continue;
+      }
+      unsigned id = top.first;
+      stack.pop_back();
+      if (_type[id] == AIG_GATE) {
+         AigGateV in0 = getFanin(id, 0);
+         AigGateV in1 = getFanin(id, 1);
+         f.var[id] = f.s->newVar();
+         f.s->addAigCNF(f.var[id], f.var[in0.getGid()], in0.isInv(), f.var[in1.getGid()], in1.isInv());
       }
+      else if (_type[id] == PI_GATE)
+         f.var[id] = f.s->newVar();
    }
 }
 
-bool
-CirMgr::proofFec(SatSolver*& s, CirGate* g1, CirGate* g2)
+// l_True if the gates differ, l_False if they are equivalent and l_Undef
+// if "budget" conflicts (< 0: no limit) are not enough to tell. The miter
+// is retired right after the proof, so the solver does not keep it live;
+// the model of a SAT result stays readable.
+lbool
+CirMgr::proofFec(FraigSolver& f, unsigned gid1, unsigned gid2, int64 budget, ostream& os)
 {
-   Var newV = s->newVar();
-   bool isInv = (~(g1->getPattern()) == g2->getPattern());
-   s->addXorCNF(newV, g1->getVar(), false, g2->getVar(), isInv);
-   s->assumeRelease();
-   s->assumeProperty(newV, true);
-   s->assertProperty(_totGates[0]->getVar(), false);
-   cout << "Proving (" << g1->getGid() << ", " << (isInv ? "!" : "") << g2->getGid() << ")..." << flush;
-   bool result = s->assumpSolve();
-   cout << (result ? "SAT" : "UNSAT") << "!!" << flush << "\r" << setw(40) << " " << "\r";
+   genProofModel(f, gid1);
+   genProofModel(f, gid2);
+   Var newV = f.s->newVar();
+   bool isInv = (fecInv(gid1) != fecInv(gid2));
+   f.s->addNeqCNF(newV, f.var[gid1], false, f.var[gid2], isInv);
+   f.s->assumeRelease();
+   f.s->assumeProperty(newV, true);
+   os << "Proving (" << gid1 << ", " << (isInv ? "!" : "") << gid2 << ")..." << flush;
+   f.s->setBudget(budget);
+   lbool result = f.s->assumpSolveLimited();
+   f.s->assertProperty(newV, false);
+   os << (result == l_True ? "SAT" : (result == l_False ? "UNSAT" : "UNDECIDED")) << "!!"
+      << flush << "\r" << setw(40) << " " << "\r";
    return result;
 }
 
+// Each entry of "mergeList" is {literal of the base gate, gate to merge};
+// the fanouts of the merged gates are appended to "moved"
 void
-CirMgr::mergeFec(vector<unsigned*>& mergeList)
+CirMgr::mergeFec(vector<unsigned*>& mergeList, IdList& moved)
 {
-   cout << "\n";
    for (auto& l : mergeList) {
-      bool isInv = (~(_totGates[l[0]]->getPattern()) == _totGates[l[1]]->getPattern());
-      _totGates[l[0]]->merge(_totGates[l[1]], isInv);
+      getFanouts(l[1], moved);
+      AigGateV base = AigGateV::fromLit(l[0]);
+      merge(base, l[1]);
       _headerInfo[4]--;
-      delete _totGates[l[1]];
-      _totGates[l[1]] = 0;
-      cout << "Fraig: " << l[0] << " merging " << (isInv ? "!" : "") << l[1] << "...\n";
+      deleteGate(l[1]);
+      cout << "Fraig: " << base.getGid() << " merging " << (base.isInv() ? "!" : "") << l[1] << "...\n";
       delete[] l;
    }
+   invalidateDfsList();
+   collectFanouts();
 }
@@ -1,7 +1,7 @@
 /****************************************************************************
   FileName     [ cirGate.cpp ]
   PackageName  [ cir ]
-  Synopsis     [ Define class CirAigGate member functions ]
+  Synopsis     [ Define gate-level functions of class CirMgr ]
   Author       [ Chung-Yang (Ric) Huang ]
   Copyright    [ Copyleft(c) 2008-present LaDs(III), GIEE, NTU, Taiwan ]
 ****************************************************************************/
@@ -17,52 +17,309 @@
 
 using namespace std;
 
-// TODO: Keep "CirGate::reportGate()", "CirGate::reportFanin()" and
-//       "CirGate::reportFanout()" for cir cmds. Feel free to define
+// TODO: Keep "CirMgr::reportGate()", "CirMgr::reportFanin()" and
+//       "CirMgr::reportFanout()" for cir cmds. Feel free to define
 //       your own variables and functions.
 
-extern CirMgr *cirMgr;
-size_t CirGate::_globalRef = 0;
+/*************************************************/
+/*   class CirMgr member functions about gates   */
+/*************************************************/
+void
+CirMgr::initGates(size_t n)
+{
+   _type.assign(n, TOT_GATE);
+   _fanin.assign(2 * n, AigGateV());
+   _fanoutSlab.release();
+   _foBegin.assign(n, 0);
+   _foSize.assign(n, 0);
+   _foCap.assign(n, 0);
+   _foDead.assign(n, 0);
+   _foPos.assign(2 * n, 0);
+   _pattern.clear();
+   _lastWord = 0;
+   _lineNo.assign(n, 0);
+   _fecGrpIdx.assign(n, UINT_MAX);
+   _fecPos.assign(n, 0);
+   _ref.assign(n, 0);
+}
+
+void
+CirMgr::addGate(unsigned gid, GateType type, unsigned lineNo)
+{
+   _type[gid] = type;
+   _lineNo[gid] = lineNo;
+}
+
+void
+CirMgr::deleteGate(unsigned gid)
+{
+   _type[gid] = TOT_GATE;
+   _fanoutSlab.free(_foBegin[gid], _foCap[gid]);
+   _foBegin[gid] = _foSize[gid] = _foCap[gid] = _foDead[gid] = 0;
+}
+
+// Make room for "n" fanout slots of "gid" in total
+void
+CirMgr::reserveFanouts(unsigned gid, size_t n)
+{
+   if (n <= _foCap[gid])
+      return;
+   size_t cap;
+   size_t begin = _fanoutSlab.alloc(n, cap);
+   moveFanouts(gid, begin);
+   _fanoutSlab.free(_foBegin[gid], _foCap[gid]);
+   _foBegin[gid] = begin;
+   _foCap[gid] = cap;
+}
+
+// Copy the live fanouts of "gid" to the slots from "begin" on, in order,
+// and drop the dead ones. The slots may overlap the old ones only if
+// "begin" is not after them.
+void
+CirMgr::moveFanouts(unsigned gid, size_t begin)
+{
+   size_t j = begin;
+   for (size_t i = _foBegin[gid]; i < _foBegin[gid] + _foSize[gid]; i++) {
+      AigGateV gv = _fanoutSlab[i];
+      if (gv == deadEdge())
+         continue;
+      _foPos[faninSlot(gv.getGid(), i)] = j;
+      _fanoutSlab[j++] = gv;
+   }
+   _foSize[gid] -= _foDead[gid];
+   _foDead[gid] = 0;
+}
+
+// Return the slot of the new fanout
+size_t
+CirMgr::addFanout(unsigned gid, const AigGateV& gv)
+{
+   if (_foSize[gid] == _foCap[gid]) {
+      if (2 * _foDead[gid] >= _foSize[gid] && _foDead[gid])
+         moveFanouts(gid, _foBegin[gid]);
+      else
+         reserveFanouts(gid, _foCap[gid] ? 2 * _foCap[gid] : 2);
+   }
+   size_t pos = _foBegin[gid] + _foSize[gid]++;
+   _fanoutSlab[pos] = gv;
+   return pos;
+}
 
-/**************************************/
-/*   class CirGate member functions   */
-/**************************************/
+// Remove the fanout edge of fanin "i" of "gid" from the fanin gate, in
+// O(1): the slot is only marked dead. The list of the fanin is compacted
+// once half of it is dead.
 void
-CirGate::reportGate() const
+CirMgr::detachFanin(unsigned gid, size_t i)
 {
-   string gateInfo = getTypeStr() + "(" + to_string(_gid) + ")" + (getName() == "" ? "" : "\"" + getName() + "\"") + ", line " + to_string(_lineNo);
+   unsigned in = getFanin(gid, i).getGid();
+   if (!isGate(in))
+      return;
+   _fanoutSlab[_foPos[2 * gid + i]] = deadEdge();
+   if (2 * ++_foDead[in] >= _foSize[in])
+      moveFanouts(in, _foBegin[in]);
+}
+
+// The fanouts of gate "gid" are moved to the literal "base", i.e. to
+// gate base.getGid(), inverted if base.isInv(); "gid" is detached from
+// its fanins but not deleted. The cost is proportional to the number of
+// fanouts moved, not to the size of the lists involved.
+void
+CirMgr::merge(const AigGateV& base, unsigned gid)
+{
+   for (size_t i = 0; i < nFanins(gid); i++)
+      detachFanin(gid, i);
+
+   for (size_t i = _foBegin[gid]; i < _foBegin[gid] + _foSize[gid]; i++) {
+      AigGateV fanout = _fanoutSlab[i];
+      if (fanout == deadEdge())
+         continue;
+      AigGateV newV = base ^ fanout.isInv();
+      size_t slot = faninSlot(fanout.getGid(), i);
+      _fanin[slot] = newV;
+      _foPos[slot] = addFanout(base.getGid(), AigGateV(fanout.getGid(), newV.isInv()));
+   }
+   _foSize[gid] = _foDead[gid] = 0;
+}
+
+// Append the gate IDs of the fanouts of "gid" to "list"
+void
+CirMgr::getFanouts(unsigned gid, IdList& list) const
+{
+   for (size_t i = _foBegin[gid]; i < _foBegin[gid] + _foSize[gid]; i++) {
+      if (_fanoutSlab[i] != deadEdge())
+         list.push_back(_fanoutSlab[i].getGid());
+   }
+}
+
+// Pack the fanout lists of all gates, in gate ID order, into a new slab
+// without free ranges or dead slots, i.e. plain CSR.
+void
+CirMgr::compactFanouts()
+{
+   MySlabAlloc<AigGateV> old;
+   old.swap(_fanoutSlab);
+   IdList newPos(old.size(), 0);
+   size_t nEdges = 0;
+   for (size_t gid = 0; gid < _type.size(); gid++)
+      nEdges += nFanouts(gid);
+   _fanoutSlab.reserve(nEdges);
+   for (size_t gid = 0; gid < _type.size(); gid++) {
+      size_t cap;
+      size_t begin = _fanoutSlab.alloc(nFanouts(gid), cap);
+      size_t j = begin;
+      for (size_t i = _foBegin[gid]; i < _foBegin[gid] + _foSize[gid]; i++) {
+         if (old[i] == deadEdge())
+            continue;
+         newPos[i] = j;
+         _fanoutSlab[j++] = old[i];
+      }
+      _foBegin[gid] = begin;
+      _foSize[gid] = _foCap[gid] = cap;
+      _foDead[gid] = 0;
+   }
+   for (size_t gid = 0; gid < _type.size(); gid++) {
+      for (size_t i = 0; i < nFanins(gid); i++)
+         _foPos[2 * gid + i] = newPos[_foPos[2 * gid + i]];
+   }
+}
+
+string
+CirMgr::getTypeStr(unsigned gid) const
+{
+   switch (_type[gid]) {
+      case UNDEF_GATE: return "UNDEF";
+      case PI_GATE:    return "PI";
+      case PO_GATE:    return "PO";
+      case AIG_GATE:   return "AIG";
+      case CONST_GATE: return "CONST";
+      default:         return "";
+   }
+}
+
+string
+CirMgr::getName(unsigned gid) const
+{
+   if (_type[gid] == PI_GATE)
+      return _PINames[_fanin[2 * gid].getGid()];
+   if (_type[gid] == PO_GATE)
+      return _PONames[gid - _headerInfo[0] - 1];
+   return "";
+}
+
+void
+CirMgr::printGate(unsigned gid) const
+{
+   string name = getName(gid);
+   switch (_type[gid]) {
+      case AIG_GATE:
+         cout << "AIG " << gid;
+         for (size_t i = 0; i < 2; i++) {
+            AigGateV in = getFanin(gid, i);
+            cout << " " << (isUndef(in.getGid()) ? "*" : "")
+                 << (in.isInv() ? "!" : "") << in.getGid();
+         }
+         cout << "\n";
+         break;
+      case PI_GATE:
+         cout << "PI  " << gid << (name == "" ? "\n" : (" (" + name + ")\n"));
+         break;
+      case PO_GATE: {
+         AigGateV in = getFanin(gid, 0);
+         cout << "PO  " << gid << " "
+              << (isUndef(in.getGid()) ? "*" : "") << (in.isInv() ? "!" : "") << in.getGid()
+              << (name == "" ? "\n" : (" (" + name + ")\n"));
+         break;
+      }
+      case CONST_GATE:
+         cout << "CONST0\n";
+         break;
+      case UNDEF_GATE:
+         cout << "UNDEF" << gid << "\n";
+         break;
+      default: break;
+   }
+}
+
+void
+CirMgr::reportGate(unsigned gid) const
+{
+   string name = getName(gid);
+   string gateInfo = getTypeStr(gid) + "(" + to_string(gid) + ")" + (name == "" ? "" : "\"" + name + "\"") + ", line " + to_string(_lineNo[gid]);
    cout << "================================================================================\n";
    cout << "= " << setw(77) << left << gateInfo << "\n";
    cout << "= FECs:";
-   IdList* fecGrp = cirMgr->getFecGrp(getFecGrpIdx());
-   if (fecGrp) {
-      for (auto& id : (*fecGrp)) {
-         if (id == _gid)
+   if (_fecGrpIdx[gid] < numFecGrps()) {
+      unsigned c = _fecGrpIdx[gid];
+      bool isInv = fecInv(gid);
+      for (size_t i = _fecBegin[c]; i < _fecBegin[c + 1]; i++) {
+         AigGateV gv = _fecMembers[i];
+         if (gv == deadEdge() || gv.getGid() == gid)
             continue;
-         cout << " " << (cirMgr->getGate(id)->getPattern() == _pattern ? "" : "!") << id;
+         cout << " " << (gv.isInv() == isInv ? "" : "!") << gv.getGid();
       }
    }
    cout << "\n";
    cout << "= Value: ";
-   for (int i = 63; i >= 0; i--) 
-      cout << (((i + 1) & 7) == 0 && i != 63 ? "_" : "") << ((_pattern >> i) & 1);
+   ull value = (_pattern.empty() ? 0 : getPattern(gid)[_lastWord]);
+   for (int i = 63; i >= 0; i--)
+      cout << (((i + 1) & 7) == 0 && i != 63 ? "_" : "") << ((value >> i) & 1);
    cout << "\n";
    cout << "================================================================================\n";
 }
 
 void
-CirGate::reportFanin(int level) const
+CirMgr::reportFanin(unsigned gid, int level) const
 {
    assert (level >= 0);
-   CirGate::setGlobalRef();
-   reportFanin(level, 0, false);
+   setGlobalRef();
+   reportFanin(gid, level, 0, false);
 }
 
 void
-CirGate::reportFanout(int level) const
+CirMgr::reportFanout(unsigned gid, int level) const
 {
    assert (level >= 0);
-   CirGate::setGlobalRef();
-   reportFanout(level, 0, false);
+   setGlobalRef();
+   reportFanout(gid, level, 0, false);
+}
+
+void
+CirMgr::reportFanin(unsigned gid, int level, int nSpace, bool inv) const
+{
+   cout << string(nSpace, ' ') << (inv ? "!" : "") << getTypeStr(gid) << " " << gid;
+   if (nFanins(gid) == 0 || level == 0) {
+      cout << "\n";
+      return;
+   }
+   if (isGlobalRef(gid)) {
+      cout << " (*)\n";
+      return;
+   }
+   setToGlobalRef(gid);
+   cout << "\n";
+   for (size_t i = 0; i < nFanins(gid); i++) {
+      AigGateV in = getFanin(gid, i);
+      reportFanin(in.getGid(), level - 1, nSpace + 2, in.isInv());
+   }
 }
 
+void
+CirMgr::reportFanout(unsigned gid, int level, int nSpace, bool inv) const
+{
+   cout << string(nSpace, ' ') << (inv ? "!" : "") << getTypeStr(gid) << " " << gid;
+   if (nFanouts(gid) == 0 || level == 0) {
+      cout << "\n";
+      return;
+   }
+   if (isGlobalRef(gid)) {
+      cout << " (*)\n";
+      return;
+   }
+   setToGlobalRef(gid);
+   cout << "\n";
+   for (size_t i = _foBegin[gid]; i < _foBegin[gid] + _foSize[gid]; i++) {
+      AigGateV gv = _fanoutSlab[i];
+      if (gv != deadEdge())
+         reportFanout(gv.getGid(), level - 1, nSpace + 2, gv.isInv());
+   }
+}
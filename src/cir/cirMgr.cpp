@@ -16,6 +16,8 @@
 #include "cirMgr.h"
 #include "cirGate.h"
 #include "util.h"
+#include "myFileMap.h"
+#include "myThreadPool.h"
 
 using namespace std;
 
@@ -91,18 +93,27 @@ enum CirParseError {
 /**************************************/
 /*   Static varaibles and functions   */
 /**************************************/
-static unsigned lineNo = 0;  // in printint, lineNo needs to ++
-static unsigned colNo  = 0;  // in printing, colNo needs to ++
-static char buf[1024];
-static size_t bufLen = 0;
-static string errMsg;
-static int errInt;
-static CirGate *errGate;
-static ParseType type;
+// The parser state is per thread, as "cirread -threads" parses chunks of
+// the file on worker threads (see tokenizeLines()).
+static thread_local unsigned lineNo = 0;  // in printint, lineNo needs to ++
+static thread_local unsigned colNo  = 0;  // in printing, colNo needs to ++
+static thread_local const char *buf = "";  // current line, points into the mapped file
+static thread_local size_t bufLen = 0;
+static thread_local const char *tok = "";  // current token, a slice of buf
+static thread_local size_t tokLen = 0;
+static thread_local const char *filePos = 0;
+static thread_local const char *fileEnd = 0;
+static thread_local string errMsg;
+static thread_local int errInt;
+static thread_local unsigned errLineNo;  // of the redefined gate
+static thread_local string errType;
+static thread_local ParseType type;
+static thread_local bool quiet = false;  // worker threads do not report errors
 
 static bool
 parseError(CirParseError err)
 {
+   if (quiet) return false;
    switch (err) {
       case EXTRA_SPACE:
          cerr << "[ERROR] Line " << lineNo+1 << ", Col " << colNo+1
@@ -163,7 +174,7 @@ parseError(CirParseError err)
       case REDEF_GATE:
          cerr << "[ERROR] Line " << lineNo+1 << ": Literal \"" << errInt
               << "\" is redefined, previously defined as "
-              << errGate->getTypeStr() << " in line " << errGate->getLineNo()
+              << errType << " in line " << errLineNo
               << "!!" << endl;
          break;
       case REDEF_SYMBOLIC_NAME:
@@ -187,7 +198,7 @@ parseError(CirParseError err)
    return false;
 }
 
-bool parseError(CirParseError err, string& s, int& num, char& ch)
+bool parseError(CirParseError err, int& num, char& ch)
 {
    switch (err)
    {
@@ -202,7 +213,7 @@ bool parseError(CirParseError err, string& s, int& num, char& ch)
          errMsg = (type == SYMBOLIC_NAME ? "symbolic name" : "aag");
          break;
       case ILLEGAL_IDENTIFIER:
-         errMsg = s;
+         errMsg = string(tok, tokLen);
          break;
       case MISSING_NUM:
          parseType2Str(type, errMsg);
@@ -215,7 +226,7 @@ bool parseError(CirParseError err, string& s, int& num, char& ch)
          break;
       case ILLEGAL_NUM:
          parseType2Str(type, errMsg);
-         errMsg += "(" + s + ")";
+         errMsg += "(" + string(tok, tokLen) + ")";
          break;
       case NUM_TOO_BIG:
          errInt = num;
@@ -237,18 +248,82 @@ bool parseError(CirParseError err, string& s, int& num, char& ch)
    return parseError(err);
 }
 
+// Characters past the end of the line read as '\0', like the old getline()
+// buffer did.
+static inline char
+bufChar(size_t i) { return (i < bufLen ? buf[i] : 0); }
+
+static inline bool
+tokIs(const char* s) { return tokLen == strlen(s) && strncmp(tok, s, tokLen) == 0; }
+
+// Same as myStr2Int(), but on the token in place
+static bool
+tok2Int(int& num)
+{
+   unsigned n = 0;
+   size_t i = 0;
+   bool neg = (tokLen > 0 && tok[0] == '-');
+   if (neg) i = 1;
+   if (i == tokLen) return false;
+   for (; i < tokLen; ++i) {
+      if (!isdigit(tok[i])) return false;
+      n = n * 10 + unsigned(tok[i] - '0');
+   }
+   num = int(neg ? 0 - n : n);
+   return true;
+}
+
+// Decode one unsigned LEB128 number of the binary AIGER AND section
+static bool
+decodeDelta(unsigned& x)
+{
+   x = 0;
+   for (unsigned shift = 0; filePos < fileEnd && shift < 32; shift += 7) {
+      unsigned char ch = *filePos++;
+      x |= unsigned(ch & 0x7f) << shift;
+      if (!(ch & 0x80))
+         return true;
+   }
+   return false;
+}
+
+// ... and append one for the binary AIGER writer
+static void
+encodeDelta(string& buf, unsigned x)
+{
+   while (x & ~0x7fu) {
+      buf += char((x & 0x7f) | 0x80);
+      x >>= 7;
+   }
+   buf += char(x);
+}
+
+// Point "buf" to the next line of the mapped file.
+// Return false if the line is not terminated by a newline.
+static bool
+readLine()
+{
+   const char* nl = (const char*)memchr(filePos, '\n', fileEnd - filePos);
+   const char* eol = (nl ? nl : fileEnd);
+   buf = filePos;
+   bufLen = strnlen(buf, eol - buf);
+   filePos = (nl ? nl + 1 : fileEnd);
+   return nl != 0;
+}
+
 /**************************************************************/
 /*   class CirMgr member functions for circuit construction   */
 /**************************************************************/
 bool 
-parse(string& s, unsigned& id, char endChar = 0) {
-   s = "";
+parse(unsigned& id, char endChar = 0) {
+   tok = buf + colNo;
+   tokLen = 0;
    id = 0;
    size_t begin = colNo;
    int num = 0;
    char c;
    while (colNo <= bufLen) {
-      c = buf[colNo];
+      c = bufChar(colNo);
       if (type == NEWLINE) {
          if (c != 0)
             return parseError(MISSING_NEWLINE);
@@ -258,82 +333,82 @@ parse(string& s, unsigned& id, char endChar = 0) {
       else if (type == SYMBOLIC_NAME) {
          while (c) {
             if (!isprint(c)) {
-               return parseError(ILLEGAL_SYMBOL_NAME, s, num, c);
+               return parseError(ILLEGAL_SYMBOL_NAME, num, c);
             }
-            s += c;
-            c = buf[++colNo];
+            tokLen++;
+            c = bufChar(++colNo);
          }
          colNo--;
          type = BREAK;
       }
       else {
-         if (s.empty() && (isspace(c) || !c)) {
+         if (tokLen == 0 && (isspace(c) || !c)) {
             if (c == ' ')
                return parseError(EXTRA_SPACE);
             else if (c == 0) {
                if (type == SYMBOLIC_NAME) {
-                  return parseError(MISSING_IDENTIFIER, s, num, c);
+                  return parseError(MISSING_IDENTIFIER, num, c);
                }
                else if (type >= 1 && type <= 5) {
-                  return parseError(MISSING_NUM, s, num, c);
+                  return parseError(MISSING_NUM, num, c);
                }
                else if (type == AAG) {
-                  return parseError(MISSING_IDENTIFIER, s, num, c); 
+                  return parseError(MISSING_IDENTIFIER, num, c); 
                }
                else if (type == SC) {
-                  return parseError(ILLEGAL_SYMBOL_TYPE, s, num, c);
+                  return parseError(ILLEGAL_SYMBOL_TYPE, num, c);
                }
                else {
-                  return parseError(MISSING_NUM, s, num, c);
+                  return parseError(MISSING_NUM, num, c);
                } 
             }
             else {
-               return parseError(ILLEGAL_WSPACE, s, num, c);
+               return parseError(ILLEGAL_WSPACE, num, c);
             }
          }
          if (type == SC) {
             if (c != 'i' && c != 'o' && c != 'c') {
-               return parseError(ILLEGAL_SYMBOL_TYPE, s, num, c);
+               return parseError(ILLEGAL_SYMBOL_TYPE, num, c);
             }
             else if (c == 'c') 
                type = NEWLINE;
             else 
                type = BREAK;
-            s += c;
+            tokLen++;
 
          }
          else {
             if (isspace(c) || c == 0) {
                // aag: "aag"
                if (type == AAG) {
-                  if (s != "aag") {
-                     errMsg = s;
+                  if (!tokIs("aag") && !tokIs("aig")) {
+                     errMsg = string(tok, tokLen);
                      return parseError(ILLEGAL_IDENTIFIER);
                   }
                }
                // PI | AIG gate | AIG input | PO | PI index | PO index | number of ... : num
                else {
                   // not num
-                  if (!myStr2Int(s, num) || num < 0) {
-                     return parseError(ILLEGAL_NUM, s, num, c);
+                  if (!tok2Int(num) || num < 0) {
+                     return parseError(ILLEGAL_NUM, num, c);
                   }
                   // PI index | PO index too big || ID too big
                   if (num > errInt && (type >= 6 && type <= 11)) {
                      colNo = begin;
                      if (type == PI_INDEX || type == PO_INDEX) 
-                        return parseError(NUM_TOO_BIG, s, num, c);
+                        return parseError(NUM_TOO_BIG, num, c);
                      else 
-                        return parseError(MAX_LIT_ID, s, num, c);
+                        return parseError(MAX_LIT_ID, num, c);
                   }
                   // PI | AIG gate: odd and >= 2
                   if (type == PI || type == AIG_G) {
                      if (num < 2) {
                         colNo = begin;
-                        return parseError(REDEF_CONST, s, num, c);
+                        return parseError(REDEF_CONST, num, c);
                      }
                      if (num % 2) {
                         colNo = begin;
-                        return parseError(CANNOT_INVERTED, s, num, c);
+                        return parseError(CANNOT_INVERTED, num, c);
                      }
                   }
                   id = unsigned(num);
@@ -347,8 +422,8 @@ parse(string& s, unsigned& id, char endChar = 0) {
             }
             else {
                while (!isspace(c) && c) {
-                  s += c;
-                  c = buf[++colNo];
+                  tokLen++;
+                  c = bufChar(++colNo);
                }
                colNo--;
             }
@@ -356,40 +431,107 @@ parse(string& s, unsigned& id, char endChar = 0) {
       }
       colNo++;
    }
-   if (s.empty()) {
+   if (tokLen == 0) {
       if (type == SYMBOLIC_NAME || type == AAG) 
-         return parseError(MISSING_IDENTIFIER, s, num, c);
+         return parseError(MISSING_IDENTIFIER, num, c);
       else 
-         return parseError(MISSING_NUM, s, num, c);
+         return parseError(MISSING_NUM, num, c);
    }
    
    return true;
 }
 
+// "cirread -threads": tokenize the PO and AIG lines on worker threads.
+// The rest of the file is cut into chunks at line boundaries; each chunk
+// counts its lines, then parses those among the first nLines into
+// lits[3 * line + j], up to its first bad line. Return the number of lines,
+// from the first one, that parsed fine. readCircuit() takes their literals
+// from "lits" and parses the first bad line itself, so that errors are
+// reported in line order and exactly as by the serial reader.
+static size_t
+tokenizeLines(size_t nPOs, size_t nLines, IdList& lits, size_t nThreads)
+{
+   const char* begin = filePos;
+   const char* end = fileEnd;
+   int maxLit = errInt;
+   size_t nChunks = size_t(end - begin) / (1 << 16) + 1;   // >= 64KB each
+   if (nChunks > nThreads * 4) nChunks = nThreads * 4;
+   vector<const char*> cut(nChunks + 1, end);
+   cut[0] = begin;
+   for (size_t c = 1; c < nChunks; ++c) {
+      const char* p = begin + (end - begin) / nChunks * c;
+      if (p < cut[c - 1]) p = cut[c - 1];
+      const char* nl = (const char*)memchr(p, '\n', end - p);
+      cut[c] = (nl ? nl + 1 : end);
+   }
+
+   MyThreadPool pool(nThreads);
+   vector<size_t> first(nChunks + 1, 0);
+   pool.run(nChunks, [&](size_t c) {
+      size_t n = 0;
+      for (const char* p = cut[c];
+           (p = (const char*)memchr(p, '\n', cut[c + 1] - p)); ++p)
+         ++n;
+      first[c + 1] = n;
+   });
+   for (size_t c = 0; c < nChunks; ++c)
+      first[c + 1] += first[c];
+
+   vector<size_t> bad(nChunks, nLines);
+   pool.run(nChunks, [&](size_t c) {
+      quiet = true;
+      errInt = maxLit;
+      filePos = cut[c];
+      fileEnd = cut[c + 1];
+      for (size_t i = first[c]; i < nLines && filePos < fileEnd; ++i) {
+         readLine();
+         colNo = 0;
+         bool ok = true;
+         if (i < nPOs) {
+            type = PO;
+            ok = parse(lits[3 * i], 0);
+         }
+         for (size_t j = 0; i >= nPOs && ok && j <= 2; ++j) {
+            type = (j == 0 ? AIG_G : AIG_IN);
+            ok = parse(lits[3 * i + j], j == 2 ? 0 : ' ');
+         }
+         if (!ok) { bad[c] = i; break; }
+      }
+      quiet = false;
+   });
+
+   // the calling thread took part; restore its state
+   filePos = begin;
+   fileEnd = end;
+   errInt = maxLit;
+   colNo = 0;
+   return *min_element(bad.begin(), bad.end());
+}
+
 bool
-CirMgr::readCircuit(const string& fileName)
+CirMgr::readCircuit(const string& fileName, size_t nThreads)
 {
    lineNo = 0;
    colNo = 0;
-   ifstream ifs(fileName.c_str());
-   if (!ifs) {
+   MyFileMap file;
+   if (!file.open(fileName)) {
       cerr << "Cannot open design \"" + fileName + "\"!!" << endl;
       return false; 
    }
-   string s;
-   s.reserve(1024);
+   filePos = file.data();
+   fileEnd = file.data() + file.size();
    unsigned id;
 
    // Header
-   ifs.getline(buf, 1024);
-   bufLen = strlen(buf);
+   readLine();
    type = AAG;
-   if (!parse(s, id, ' '))
+   if (!parse(id, ' '))
       return false;
-   if (s != "aag") {
-      errMsg = s;
+   if (!tokIs("aag") && !tokIs("aig")) {
+      errMsg = string(tok, tokLen);
       return parseError(ILLEGAL_IDENTIFIER);
    }
+   bool binary = tokIs("aig");
    for (size_t i = 0; i < 5; i++) {
       switch (i) {
          case 0: type = NUM_OF_VAR; break;
@@ -400,10 +542,10 @@ CirMgr::readCircuit(const string& fileName)
          default: break;
       }
       char endChar = (i == 4 ? 0 : ' ');
-      if (!parse(s, id, endChar))
+      if (!parse(id, endChar))
          return false;
       
-      if (s.empty()) {
+      if (tokLen == 0) {
          return parseError(MISSING_NUM);
       }
       _headerInfo[i] = id;
@@ -417,35 +559,51 @@ CirMgr::readCircuit(const string& fileName)
       errMsg = "latches";
       return parseError(ILLEGAL_NUM);
    }
+   // Binary AIGER numbers PIs and AIGs consecutively, so M is exact
+   if (binary && _headerInfo[0] > _headerInfo[1] + _headerInfo[4]) {
+      errMsg = "Number of variables";
+      errInt = _headerInfo[0];
+      return parseError(NUM_TOO_BIG);
+   }
 
    colNo = 0;
    lineNo++;
-   _totGates = GateList(_headerInfo[0] + _headerInfo[3] + 1, 0);
+   initGates(_headerInfo[0] + _headerInfo[3] + 1);
    _PIIds.reserve(_headerInfo[1]);
    _POIds.reserve(_headerInfo[3]);
-   vector<size_t> fanoutCapacity(_headerInfo[0] + 1, 1);
+   _PINames.resize(_headerInfo[1]);
+   _PONames.resize(_headerInfo[3]);
 
    // CONST0
-   _totGates[0] = new CONST0Gate();
+   addGate(0, CONST_GATE);
 
    // Inputs
    errInt = 2 * _headerInfo[0] + 1;
    for (size_t i = 0; i < _headerInfo[1]; i++) {
+      // Binary AIGER: PI literals are implicitly 2, 4, ..., 2I
+      if (binary) {
+         addGate(i + 1, PI_GATE, lineNo + 1);
+         _fanin[2 * (i + 1)] = AigGateV(i);
+         _PIIds.push_back(i + 1);
+         lineNo++;
+         continue;
+      }
       type = PI;
-      if (!ifs.getline(buf, 1024) || ifs.eof())
+      if (!readLine())
          break;
-      bufLen = strlen(buf);
 
-      if (!parse(s, id, 0))
+      if (!parse(id, 0))
          return false;
       
-      if (_totGates[id / 2]) {
-         errGate = _totGates[id / 2];
+      if (isGate(id / 2)) {
+         errType = getTypeStr(id / 2);
+         errLineNo = _lineNo[id / 2];
          errInt = id;
          return parseError(REDEF_GATE);
       }
 
-      _totGates[id / 2] = new PIGate(id / 2, lineNo + 1);
+      addGate(id / 2, PI_GATE, lineNo + 1);
+      _fanin[id] = AigGateV(i);
       _PIIds.push_back(id / 2);
       colNo = 0;
       lineNo++;
@@ -457,21 +615,29 @@ CirMgr::readCircuit(const string& fileName)
 
    // Latches (skip)
 
+   // Lines before nParsed are already tokenized by -threads
+   IdList lits;
+   size_t nParsed = 0;
+   if (!binary && nThreads > 1) {
+      size_t nLines = _headerInfo[3] + _headerInfo[4];
+      lits.resize(3 * nLines);
+      nParsed = tokenizeLines(_headerInfo[3], nLines, lits, nThreads);
+   }
+
    // Outputs
-   vector<unsigned> POInfo(_headerInfo[3], 0);
    for (size_t i = 0; i < _headerInfo[3]; i++) {
       type = PO;
-      if (!ifs.getline(buf, 1024) || ifs.eof())
+      if (!readLine())
          break;
-      bufLen = strlen(buf);
 
-      if (!parse(s, id, 0))
+      if (i < nParsed)
+         id = lits[3 * i];
+      else if (!parse(id, 0))
          return false;
       
-      _totGates[_headerInfo[0] + i + 1] = new POGate(_headerInfo[0] + i + 1, lineNo + 1);
+      addGate(_headerInfo[0] + i + 1, PO_GATE, lineNo + 1);
+      _fanin[2 * (_headerInfo[0] + i + 1)] = AigGateV::fromLit(id);
       _POIds.push_back(_headerInfo[0] + i + 1);
-      fanoutCapacity[id / 2]++;
-      POInfo[i] = id;
       colNo = 0;
       lineNo++;
    }
@@ -481,114 +647,167 @@ CirMgr::readCircuit(const string& fileName)
    };
 
    // Ands
-   vector<vector<unsigned>> AigInfo(_headerInfo[4], vector<unsigned>(3, 0));
+   // A fanin may be defined after its fanout, so ASCII fanins are only
+   // recorded here and linked after the whole file is read.
    size_t nAigCheck = 0;
-   for (size_t i = 0; i < _headerInfo[4]; i++) {
-      if (!ifs.getline(buf, 1024) || ifs.eof())
+   if (binary && !readAigDeltas(nAigCheck))
+      return false;
+   for (size_t i = 0; i < (binary ? 0 : _headerInfo[4]); i++) {
+      if (!readLine())
          break; 
-      bufLen = strlen(buf);
 
+      unsigned gid = 0;
+      size_t l = _headerInfo[3] + i;
       for (size_t j = 0; j <= 2; j++) {
          type = (j == 0 ? AIG_G : AIG_IN);
          char endChar = (j == 2 ? 0 : ' '); 
-         if (!parse(s, id, endChar))
+         if (l < nParsed)
+            id = lits[3 * l + j];
+         else if (!parse(id, endChar))
             return false;
          
-         AigInfo[i][j] = id;
          if (j == 0) {
-            if (_totGates[id / 2]) {
-               errGate = _totGates[id / 2];
+            if (isGate(id / 2)) {
+               errType = getTypeStr(id / 2);
+               errLineNo = _lineNo[id / 2];
                errInt = id;
                return parseError(REDEF_GATE);
             }
-            _totGates[id / 2] = new AigGate(id / 2, lineNo + 1);
+            gid = id / 2;
+            addGate(gid, AIG_GATE, lineNo + 1);
             nAigCheck++;
          }
          else 
-            fanoutCapacity[id / 2]++;
+            _fanin[2 * gid + j - 1] = AigGateV::fromLit(id);
       }
       
+      // pages already parsed are not needed any more
+      if ((i & 0xfffff) == 0xfffff)
+         file.release(filePos);
       colNo = 0;
       lineNo++;
    }
+   IdList().swap(lits);
    if (nAigCheck < _headerInfo[4]) {
       errMsg = "AIG";
       return parseError(MISSING_DEF);
    }
 
    // Symbols and Comments
-   while (ifs.getline(buf, 1024) || !ifs.eof()) {
-      bufLen = strlen(buf);
+   while (filePos < fileEnd) {
+      readLine();
       type = SC;
-      if (!parse(s, id))
+      if (!parse(id))
          return false;
 
-      if (s == "c")
+      if (tokIs("c"))
          break;
          
       // index
-      string s_copy = s;
-      type = (s == "i" ? PI_INDEX : PO_INDEX);
-      errInt = (s == "i" ? _headerInfo[1] : _headerInfo[3]);
-      IdList& l = (s == "i" ? _PIIds : _POIds);
+      bool isPI = tokIs("i");
+      type = (isPI ? PI_INDEX : PO_INDEX);
+      errInt = (isPI ? _headerInfo[1] : _headerInfo[3]);
 
-      if (!parse(s, id, ' '))
+      if (!parse(id, ' '))
          return false; 
       
-      CirGate* g = _totGates[l[id]];
+      string& name = (isPI ? _PINames : _PONames)[id];
       unsigned id_copy = id;
       // name
       type = SYMBOLIC_NAME;
-      if (!parse(s, id))
+      if (!parse(id))
          return false;
       
-      if (g->getName() != "") {
-         errMsg = s_copy;
+      if (name != "") {
+         errMsg = (isPI ? "i" : "o");
          errInt = id_copy;
          return parseError(REDEF_SYMBOLIC_NAME);
       }
 
-      g->setName(s);
+      name = string(tok, tokLen);
       
       colNo = 0;
       lineNo++;
    }
 
-   ifs.close();
+   file.close();
 
-   for (size_t i = 0; i < fanoutCapacity.size(); i++) {
-      if (_totGates[i])
-         _totGates[i]->reserveFaninList(fanoutCapacity[i]);
-   }
+   // Binary AIGs are already linked by readAigDeltas(); only POs are left
+   linkFanins(binary);
 
-   for (size_t i = 0; i < POInfo.size(); i++) {
-      size_t gid = _headerInfo[0] + i + 1;
-      size_t fanin_gid = POInfo[i];
-      if (!_totGates[fanin_gid / 2]) {
-         _totGates[fanin_gid / 2] = new UNDEFGate(fanin_gid / 2);
-         _totGates[fanin_gid / 2]->reserveFaninList(fanoutCapacity[fanin_gid / 2]);
-      }
-      _totGates[gid]->setFanin(AigGateV(_totGates[fanin_gid / 2], fanin_gid % 2, fanin_gid / 2));
-      _totGates[fanin_gid / 2]->addFanout(AigGateV(_totGates[gid], fanin_gid % 2, gid));
-   }
-   for (size_t i = 0; i < AigInfo.size(); i++) {
-      size_t gid = AigInfo[i][0];
-      for (size_t j = 1; j <= 2; j++) {
-         size_t fanin_gid = AigInfo[i][j];
-         if (!_totGates[fanin_gid / 2]) {
-            _totGates[fanin_gid / 2] = new UNDEFGate(fanin_gid / 2);
-            _totGates[fanin_gid / 2]->reserveFaninList(fanoutCapacity[fanin_gid / 2]);
-         }
-         _totGates[fanin_gid / 2]->addFanout(AigGateV(_totGates[gid / 2], fanin_gid % 2, gid / 2));
+   return true;
+}
+
+// Create UNDEF gates for the fanins that are not defined, count the
+// fanouts of every gate, then fill the exactly sized fanout lists in
+// increasing fanout ID. The lists come out sorted, so no sorting pass is
+// needed. For binary input only the POs are left to link.
+void
+CirMgr::linkFanins(bool poOnly)
+{
+   size_t begin = (poOnly ? _headerInfo[0] + 1 : 0);
+   IdList nFanouts(poOnly ? 0 : _type.size(), 0);
+   for (size_t i = begin; i < _type.size(); i++) {
+      for (size_t j = 0; j < nFanins(i); j++) {
+         unsigned id = getFanin(i, j).getGid();
+         if (!isGate(id))
+            addGate(id, UNDEF_GATE);
+         if (!poOnly)
+            nFanouts[id]++;
       }
-      _totGates[gid / 2]->setFanin(AigGateV(_totGates[AigInfo[i][1] / 2], AigInfo[i][1] % 2, AigInfo[i][1] / 2), AigGateV(_totGates[AigInfo[i][2] / 2], AigInfo[i][2] % 2, AigInfo[i][2] / 2));
    }
-   
-   for (auto& g : _totGates) {
-      if (g)
-         g->sortFanoutList();
+   size_t nEdges = 0;
+   for (size_t i = 0; i < nFanouts.size(); i++)
+      nEdges += nFanouts[i];
+   _fanoutSlab.reserve(nEdges);
+   for (size_t i = 0; i < nFanouts.size(); i++)
+      reserveFanouts(i, nFanouts[i]);
+   for (size_t i = begin; i < _type.size(); i++) {
+      if (nFanins(i) == 0)
+         continue;
+      AigGateV in0 = getFanin(i, 0);
+      if (_type[i] == PO_GATE) {
+         _foPos[2 * i] = addFanout(in0.getGid(), AigGateV(i, in0.isInv()));
+         continue;
+      }
+      AigGateV in1 = getFanin(i, 1);
+      // the same fanin in both phases: the non-inverted edge goes first
+      size_t first = (in0.getGid() == in1.getGid() && in0.isInv());
+      _foPos[2 * i + first] = addFanout(getFanin(i, first).getGid(), AigGateV(i, getFanin(i, first).isInv()));
+      _foPos[2 * i + !first] = addFanout(getFanin(i, !first).getGid(), AigGateV(i, getFanin(i, !first).isInv()));
    }
+}
 
+// Binary AIGER: the i-th AIG has literal 2(I + i + 1) and its inputs are
+// stored as two LEB128 deltas (lhs - rhs0, rhs0 - rhs1) with rhs0 >= rhs1.
+// Every input is defined before it is used, so gates are created and
+// wired as they are decoded.
+bool
+CirMgr::readAigDeltas(size_t& nAig)
+{
+   for (size_t i = 0; i < _headerInfo[4]; i++) {
+      unsigned gid = _headerInfo[1] + i + 1;
+      unsigned delta[2];
+      for (size_t j = 0; j < 2; j++) {
+         if (!decodeDelta(delta[j]))
+            return true;            // reported as missing AIG definitions
+      }
+      bool bad0 = (delta[0] == 0 || delta[0] > 2 * gid);
+      if (bad0 || delta[1] > 2 * gid - delta[0]) {
+         errMsg = "AIG Input literal delta(" + to_string(delta[bad0 ? 0 : 1]) + ")";
+         return parseError(ILLEGAL_NUM);
+      }
+      AigGateV in0 = AigGateV::fromLit(2 * gid - delta[0]);
+      AigGateV in1 = AigGateV::fromLit(in0.getLit() - delta[1]);
+      addGate(gid, AIG_GATE, lineNo + 1);
+      _fanin[2 * gid] = in0;
+      _fanin[2 * gid + 1] = in1;
+      // in1 <= in0, so adding in1 first keeps the fanout lists sorted
+      _foPos[2 * gid + 1] = addFanout(in1.getGid(), AigGateV(gid, in1.isInv()));
+      _foPos[2 * gid] = addFanout(in0.getGid(), AigGateV(gid, in0.isInv()));
+      nAig++;
+      lineNo++;
+   }
    return true;
 }
 
@@ -621,13 +840,12 @@ void
 CirMgr::printNetlist() const
 {
    cout << "\n";
-   GateList dfsList;
-   updateDfsList(dfsList);
+   const IdList& dfsList = getDfsList();
    size_t i = 0;
-   for (const auto& g : dfsList) {
-      if (g->getType() != UNDEF_GATE) {
+   for (const auto& id : dfsList) {
+      if (_type[id] != UNDEF_GATE) {
          cout << "[" << i++ << "] ";
-         g->printGate();
+         printGate(id);
       }
    }
 }
@@ -655,15 +873,18 @@ CirMgr::printFloatGates() const
 {
    IdList fFaninId;
    IdList unusedId;
-   for (const auto& g : _totGates) {
-      if (g != 0) {
-         if (g->checkFFanin()) {
-            fFaninId.push_back(g->getGid());
-         }
-         if (g->checkUnused()) {
-            unusedId.push_back(g->getGid());
+   for (size_t i = 0; i < _type.size(); i++) {
+      if (!isGate(i))
+         continue;
+      for (size_t j = 0; j < nFanins(i); j++) {
+         if (isUndef(getFanin(i, j).getGid())) {
+            fFaninId.push_back(i);
+            break;
          }
       }
+      // POs and CONST0 are never reported unused
+      if (_type[i] != PO_GATE && _type[i] != CONST_GATE && nFanouts(i) == 0)
+         unusedId.push_back(i);
    }
    if (!fFaninId.empty()) {
       cout << "Gates with floating fanin(s):"; 
@@ -682,124 +903,215 @@ CirMgr::printFloatGates() const
 void
 CirMgr::printFECPairs() const
 {
-   if (_fecGrps.empty())
-      return;
-   for (size_t i = 0; i < _fecGrps.size(); i++) {
+   for (size_t i = 0; i < numFecGrps(); i++) {
       cout << "[" << i << "]"; 
-      for (const auto& id : (*_fecGrps[i])) {
-         cout << " " << (_totGates[id]->getPattern() == _totGates[(*_fecGrps[i])[0]]->getPattern() ? "" : "!") << _totGates[id]->getGid();
+      for (size_t j = _fecBegin[i]; j < _fecBegin[i + 1]; j++) {
+         const AigGateV& gv = _fecMembers[j];
+         cout << " " << (gv.isInv() == _fecMembers[_fecBegin[i]].isInv() ? "" : "!") << gv.getGid();
       }
       cout << "\n";
    }
 }
 
+/*********************
+Memory Statistics
+==============================
+  Gate IDs               354
+  Gate arrays       0.019 MB
+  Fanout slots           825
+  Free slots             162
+  Fanout slab       0.005 MB
+  Sim words                8
+  Sim values        0.022 MB
+------------------------------
+  Slab allocs            366
+  Slab frees              93
+  Slab reuses             10
+*********************/
 void
-CirMgr::writeAag(ostream& outfile) const
+CirMgr::printMemory() const
 {
-   GateList dfsList;
-   updateDfsList(dfsList);
-   GateList aigList;
+   size_t gateBytes = _type.capacity() + _fanin.capacity() * sizeof(AigGateV)
+      + (_lineNo.capacity() + _fecGrpIdx.capacity() + _fecPos.capacity() + _ref.capacity()) * sizeof(unsigned)
+      + (_foBegin.capacity() + _foSize.capacity() + _foCap.capacity()) * sizeof(unsigned)
+      + (_foDead.capacity() + _foPos.capacity() + _dfsPos.capacity()) * sizeof(unsigned);
+   size_t slabBytes = _fanoutSlab.capacity() * sizeof(AigGateV);
+   cout << endl
+        << "Memory Statistics" << endl
+        << "==============================" << endl
+        << "  Gate IDs     " << setw(13) << right << _type.size() << endl
+        << "  Gate arrays  " << setw(10) << right << fixed << setprecision(3) << gateBytes / double(1 << 20) << " MB" << endl
+        << "  Fanout slots " << setw(13) << right << _fanoutSlab.size() << endl
+        << "  Free slots   " << setw(13) << right << _fanoutSlab.numFreeElems() << endl
+        << "  Fanout slab  " << setw(10) << right << slabBytes / double(1 << 20) << " MB" << endl
+        << "  Sim words    " << setw(13) << right << _simWords << endl
+        << "  Sim values   " << setw(10) << right << _pattern.capacity() * sizeof(ull) / double(1 << 20) << " MB" << endl
+        << "------------------------------" << endl
+        << "  Slab allocs  " << setw(13) << right << _fanoutSlab.numAlloc() << endl
+        << "  Slab frees   " << setw(13) << right << _fanoutSlab.numFree() << endl
+        << "  Slab reuses  " << setw(13) << right << _fanoutSlab.numReuse() << endl;
+   cout.unsetf(ios::fixed);
+   cout << setprecision(6);
+}
+
+void
+CirMgr::writeAag(ostream& outfile, bool binary) const
+{
+   const IdList& dfsList = getDfsList();
+   IdList aigList;
    aigList.reserve(_headerInfo[4]);
-   for (const auto& g : dfsList) {
-      if (g->getTypeStr() == "AIG")
-         aigList.push_back(g);
-   }
-   outfile << "aag";
-   for (size_t i = 0; i < 4; i++) 
-      outfile << " " << _headerInfo[i];
-   outfile << " " << aigList.size();
-   outfile << "\n";
-   
-   for (const auto& id : _PIIds)
-      _totGates[id]->write(outfile);
-   for (const auto& id : _POIds)
-      _totGates[id]->write(outfile);
-   for (const auto& g : aigList)
-      g->write(outfile);
+   for (const auto& id : dfsList) {
+      if (_type[id] == AIG_GATE)
+         aigList.push_back(id);
+   }
+   if (binary) {
+      GateVList poList;
+      poList.reserve(_POIds.size());
+      for (const auto& id : _POIds)
+         poList.push_back(getFanin(id, 0));
+      writeAig(outfile, _PIIds, aigList, poList);
+   }
+   else {
+      outfile << "aag";
+      for (size_t i = 0; i < 4; i++) 
+         outfile << " " << _headerInfo[i];
+      outfile << " " << aigList.size();
+      outfile << "\n";
+      
+      for (const auto& id : _PIIds)
+         outfile << id * 2 << "\n";
+      for (const auto& id : _POIds)
+         outfile << getFanin(id, 0).getLit() << "\n";
+      for (const auto& id : aigList)
+         outfile << id * 2 << " " << getFanin(id, 0).getLit() << " " << getFanin(id, 1).getLit() << "\n";
+   }
 
    for (size_t i = 0; i < _PIIds.size(); i++) {
-      if (_totGates[_PIIds[i]]->getName() != "")
-         outfile << "i" << i << " " << _totGates[_PIIds[i]]->getName() << "\n";
+      if (_PINames[i] != "")
+         outfile << "i" << i << " " << _PINames[i] << "\n";
    }
    for (size_t i = 0; i < _POIds.size(); i++) {
-      if (_totGates[_POIds[i]]->getName() != "")
-         outfile << "o" << i << " " << _totGates[_POIds[i]]->getName() << "\n";
+      if (_PONames[i] != "")
+         outfile << "o" << i << " " << _PONames[i] << "\n";
    }
    outfile << "c\n";
    outfile << "AAG output by Yu-Kai Ling\n";
 }
 
 void
-CirMgr::writeGate(ostream& outfile, CirGate *g) const
+CirMgr::writeGate(ostream& outfile, unsigned gid, bool binary) const
 {
-   CirGate::setGlobalRef();
-   GateList dfsList;
-   GateList piList;
-   GateList aigList;
-   dfsTraversal(g, dfsList);
+   setGlobalRef();
+   IdList dfsList;
+   IdList piList;
+   IdList aigList;
+   dfsTraversal(gid, dfsList);
    size_t M = 0;
-   for (auto& cg : dfsList) {
-      if (cg->getType() == PI_GATE) 
-         piList.push_back(cg);
-      else if (cg->getType() == AIG_GATE)
-         aigList.push_back(cg);
-      if (cg->getGid() > M)
-         M = cg->getGid();
-   }
-   sort(piList.begin(), piList.end(), [](CirGate* g1, CirGate* g2) {
-      return g1->getGid() < g2->getGid();
-   });
-   outfile << "aag";
-   outfile << " " << M;
-   outfile << " " << piList.size();
-   outfile << " 0 1";
-   outfile << " " << aigList.size();
-   outfile << "\n";
-   for (auto& cg : piList) 
-      cg->write(outfile);
-   outfile << g->getGid() * 2 << "\n";
-   for (auto& cg : aigList) 
-      cg->write(outfile);
+   for (auto& id : dfsList) {
+      if (_type[id] == PI_GATE) 
+         piList.push_back(id);
+      else if (_type[id] == AIG_GATE)
+         aigList.push_back(id);
+      if (id > M)
+         M = id;
+   }
+   sort(piList.begin(), piList.end());
+   if (binary)
+      writeAig(outfile, piList, aigList, GateVList(1, AigGateV(gid)));
+   else {
+      outfile << "aag";
+      outfile << " " << M;
+      outfile << " " << piList.size();
+      outfile << " 0 1";
+      outfile << " " << aigList.size();
+      outfile << "\n";
+      for (auto& id : piList) 
+         outfile << id * 2 << "\n";
+      outfile << gid * 2 << "\n";
+      for (auto& id : aigList) 
+         outfile << id * 2 << " " << getFanin(id, 0).getLit() << " " << getFanin(id, 1).getLit() << "\n";
+   }
       
    for (size_t i = 0; i < piList.size(); i++) {
-      if (piList[i]->getName() != "")
-         outfile << "i" << i << " " << piList[i]->getName() << "\n";
+      if (getName(piList[i]) != "")
+         outfile << "i" << i << " " << getName(piList[i]) << "\n";
    }
-   outfile << "o0 " << g->getGid() << "\n";
+   outfile << "o0 " << gid << "\n";
    outfile << "c\n";
-   outfile << "Write gate (" << g->getGid() << ") by Yu-Kai Ling\n";
+   outfile << "Write gate (" << gid << ") by Yu-Kai Ling\n";
 }
 
-void 
-CirMgr::dfsTraversal(CirGate* g) const {
-   if (g->isGlobalRef())
-      return;
-   g->setToGlobalRef();
-   for (size_t i = 0; i < 2; i++) {
-      CirGate* fanin = g->getFanin(i).gate();
-      if (fanin) 
-         dfsTraversal(fanin);
+// Write the header, POs and AIGs of a binary AIGER file; the symbol table
+// is left to the caller. PIs are renumbered 1..I and AIGs I+1..I+A in the
+// given (topological) order, so each AIG is stored as two LEB128 deltas.
+// Floating (UNDEF) fanins cannot be expressed and are tied to CONST0,
+// which is also how they simulate.
+void
+CirMgr::writeAig(ostream& outfile, const IdList& piList, const IdList& aigList, const GateVList& poList) const
+{
+   IdList newId(_type.size(), 0);
+   unsigned M = 0;
+   for (const auto& id : piList)
+      newId[id] = ++M;
+   for (const auto& id : aigList)
+      newId[id] = ++M;
+
+   string buf;
+   buf.reserve(64 + 8 * poList.size() + 4 * aigList.size());
+   buf += "aig " + to_string(M) + " " + to_string(piList.size()) + " 0 " + to_string(poList.size()) + " " + to_string(aigList.size()) + "\n";
+   for (const auto& gv : poList)
+      buf += to_string(newId[gv.getGid()] * 2 + gv.isInv()) + "\n";
+   for (const auto& id : aigList) {
+      unsigned lhs = newId[id] * 2;
+      unsigned rhs0 = newId[getFanin(id, 0).getGid()] * 2 + getFanin(id, 0).isInv();
+      unsigned rhs1 = newId[getFanin(id, 1).getGid()] * 2 + getFanin(id, 1).isInv();
+      if (rhs0 < rhs1)
+         swap(rhs0, rhs1);
+      encodeDelta(buf, lhs - rhs0);
+      encodeDelta(buf, rhs0 - rhs1);
    }
+   outfile.write(buf.data(), buf.size());
 }
 
+// Append the gates in the fanin cone of "gid" that are not yet marked
+// with the global ref to "dfsList", in post order (fanin 0 first). The
+// stack is explicit, so deep cones do not overflow the call stack.
 void 
-CirMgr::dfsTraversal(CirGate* g, GateList& dfsList) const {
-   if (g->isGlobalRef())
+CirMgr::dfsTraversal(unsigned gid, IdList& dfsList) const {
+   if (isGlobalRef(gid))
       return;
-   g->setToGlobalRef();
-   for (size_t i = 0; i < 2; i++) {
-      CirGate* fanin = g->getFanin(i).gate();
-      if (fanin != 0)
-         dfsTraversal(fanin, dfsList);
+   setToGlobalRef(gid);
+   vector<pair<unsigned, unsigned> > stack(1, make_pair(gid, 0));
+   while (!stack.empty()) {
+      pair<unsigned, unsigned>& top = stack.back();
+      if (top.second < nFanins(top.first)) {
+         unsigned fanin = getFanin(top.first, top.second++).getGid();
+         if (!isGlobalRef(fanin)) {
+            setToGlobalRef(fanin);
+            stack.push_back(make_pair(fanin, 0));
+         }
+      }
+      else {
+         dfsList.push_back(top.first);
+         stack.pop_back();
+      }
    }
-   dfsList.push_back(g);
 }
 
-void
-CirMgr::updateDfsList(GateList& dfsList) const {
-   dfsList.clear();
-   CirGate::setGlobalRef();
-   for (const auto& id : _POIds) {
-      dfsTraversal(_totGates[id], dfsList);
+// The DFS list from all POs is kept until the structure is changed by
+// optimize(), strash() or mergeFec(); sweep() only removes gates that
+// are not in it. _dfsPos[gid] is the index of "gid" in it, or UINT_MAX.
+const IdList&
+CirMgr::getDfsList() const {
+   if (!_dfsValid) {
+      _dfsList.clear();
+      setGlobalRef();
+      for (const auto& id : _POIds)
+         dfsTraversal(id, _dfsList);
+      _dfsPos.assign(_type.size(), UINT_MAX);
+      for (size_t i = 0; i < _dfsList.size(); i++)
+         _dfsPos[_dfsList[i]] = i;
+      _dfsValid = true;
    }
-}
\ No newline at end of file
+   return _dfsList;
+}
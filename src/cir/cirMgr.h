@@ -14,6 +14,9 @@
 #include <fstream>
 #include <iostream>
 #include "cirGate.h"
+#include "mySlabAlloc.h"
+#include "myThreadPool.h"
+#include "rnGen.h"
 
 using namespace std;
 
@@ -23,37 +26,28 @@ using namespace std;
 
 extern CirMgr *cirMgr;
 
+struct FecRefineBuf;
+struct FraigSolver;
+
 class CirMgr
 {
 public:
-   CirMgr() : _initFec(false), _fecGrps(0) {}
-   ~CirMgr() {
-      for (size_t i = 0; i < _totGates.size(); i++) {
-         if (_totGates[i]) {
-            delete _totGates[i];
-            _totGates[i] = 0;
-         }
-      }
-      for (auto& fecGrp : _fecGrps) {
-         if (fecGrp)
-            delete fecGrp;
-         fecGrp = 0;
-      }
-   }
+   CirMgr() : _simLog(0), _simLogBinary(false), _simLogHeader(false), _initFec(false), _fecBegin(1, 0), _freshFecGrp(UINT_MAX), _simWords(8), _lastWord(0), _simRng(1), _fraigEffort(0), _globalRef(0), _dfsValid(false), _simProgValid(false) {}
+   ~CirMgr() {}
 
    // Access functions
-   // return '0' if "gid" corresponds to an undefined gate.
-   CirGate* getGate(unsigned gid) const { 
-      return (gid >= _totGates.size() ? 0 : _totGates[gid]);
+   // return false if "gid" corresponds to an undefined gate.
+   bool isGate(unsigned gid) const {
+      return gid < _type.size() && _type[gid] != TOT_GATE;
    }
-   IdList* getFecGrp(const size_t& id) { return (id < _fecGrps.size() ? _fecGrps[id] : 0); }
+   GateType getType(unsigned gid) const { return GateType(_type[gid]); }
 
    // Member functions about circuit construction
-   bool readCircuit(const string&);
+   bool readCircuit(const string&, size_t nThreads = 1);
 
    // Travelsal
-   void dfsTraversal(CirGate*) const;
-   void dfsTraversal(CirGate*, GateList&) const;
+   void dfsTraversal(unsigned, IdList&) const;
+   const IdList& getDfsList() const;
 
    // Member functions about circuit optimization
    void sweep();
@@ -62,12 +56,25 @@ public:
    // Member functions about simulation
    void randomSim();
    void fileSim(ifstream&);
-   void setSimLog(ofstream *logFile) { _simLog = logFile; }
+   // a binary log is described in writeSimLog()
+   void setSimLog(ofstream *logFile, bool binary = false) {
+      _simLog = logFile; _simLogBinary = binary; _simLogHeader = false;
+   }
+   // the simulation values are dropped if the width changes
+   void setSimWords(size_t n) {
+      if (n != _simWords) { _simWords = n; _pattern.clear(); _lastWord = 0; }
+   }
+   size_t getSimWords() const { return _simWords; }
+   void setSimThreads(size_t n) { _simPool.resize(n); }
+   // restart the random patterns of randomSim()
+   void setSimSeed(unsigned long long seed) { _simRng.assign(1, RandomWordGen(seed)); }
 
    // Member functions about fraig
    void strash();
    void printFEC() const;
-   void fraig();
+   void fraig(bool mergeNow = false);
+   // the SAT budgets of fraig(), see fraigBudget() in cirFraig.cpp
+   void setFraigEffort(unsigned n) { _fraigEffort = n; }
 
    // Member functions about circuit reporting
    void printSummary() const;
@@ -76,24 +83,136 @@ public:
    void printPOs() const;
    void printFloatGates() const;
    void printFECPairs() const;
-   void writeAag(ostream&) const;
-   void writeGate(ostream&, CirGate*) const;
+   void printMemory() const;
+   void writeAag(ostream&, bool binary = false) const;
+   void writeGate(ostream&, unsigned, bool binary = false) const;
+
+   // Member functions about gate reporting (cirGate.cpp)
+   void reportGate(unsigned) const;
+   void reportFanin(unsigned, int) const;
+   void reportFanout(unsigned, int) const;
 
 private:
    ofstream           *_simLog;
+   bool                _simLogBinary;
+   bool                _simLogHeader;   // the binary header is written
    IdList _PIIds;
    IdList _POIds;
-   GateList _totGates;
    unsigned _headerInfo[5];
    bool _initFec;
-   vector<IdList*> _fecGrps;
-   void initFecGrps(GateList&);
-   void simulate(GateList&, size_t);
+   // The simulation words of the members of a group, each inverted if its
+   // phase is, have been the same for every pattern so far. All groups are
+   // one partition: group c is _fecMembers[_fecBegin[c]] up to (but not
+   // including) _fecMembers[_fecBegin[c + 1]], and a gate in group
+   // _fecGrpIdx[gid] is the member in slot _fecPos[gid]. A member removed
+   // by fraig() is deadEdge() until the groups are refined.
+   GateVList _fecMembers;
+   IdList    _fecBegin;
+   unsigned  _freshFecGrp;       // made by initFecGrps(), no phases yet
+   size_t _simWords;             // simulation width, in 64-bit words
+   size_t _lastWord;             // the word with the latest patterns
+   vector<RandomWordGen> _simRng;  // one stream per 64 PIs
+   unsigned _fraigEffort;        // tries of a proof with a budget, 0: no limit
+
+   // Gates, indexed by gate ID (struct of arrays). _type[gid] is TOT_GATE
+   // if there is no such gate. An AIG has the fanins _fanin[2 * gid] and
+   // _fanin[2 * gid + 1]; a PO has only the first one, and a PI keeps its
+   // index in _PIIds there instead (as a gate ID).
+   // The fanouts of a gate are the slots _fanoutSlab[_foBegin[gid] + i],
+   // i < _foSize[gid], less the _foDead[gid] slots that are deadEdge().
+   // _foPos[2 * gid + i] is the slot of the fanout edge of fanin i, so an
+   // edge is removed without searching the list.
+   // The _simWords simulation words of a gate are _pattern[gid * _simWords]
+   // on; _pattern is empty until the first simulation.
+   vector<unsigned char>      _type;
+   GateVList                  _fanin;
+   MySlabAlloc<AigGateV>      _fanoutSlab;
+   IdList                     _foBegin;
+   IdList                     _foSize;
+   IdList                     _foCap;
+   IdList                     _foDead;
+   IdList                     _foPos;
+   vector<ull>                _pattern;
+   IdList                     _lineNo;
+   IdList                     _fecGrpIdx;
+   IdList                     _fecPos;
+   vector<string>             _PINames;
+   vector<string>             _PONames;
+   mutable IdList             _ref;
+   mutable unsigned           _globalRef;
+   mutable IdList             _dfsList;  // see getDfsList()
+   mutable IdList             _dfsPos;
+   mutable bool               _dfsValid;
+   mutable vector<SimInstr>   _simProg;     // see getSimProgram()
+   mutable IdList             _levelBegin;
+   mutable bool               _simProgValid;
+   mutable bool               _simProgByLevel;
+   MyThreadPool               _simPool;
+
+   // Gate helpers
+   size_t nFanins(unsigned gid) const {
+      return (_type[gid] == AIG_GATE ? 2 : (_type[gid] == PO_GATE ? 1 : 0));
+   }
+   AigGateV getFanin(unsigned gid, size_t i) const { return _fanin[2 * gid + i]; }
+   bool isUndef(unsigned gid) const { return _type[gid] == UNDEF_GATE; }
+   void invalidateDfsList() { _dfsValid = _simProgValid = false; }
+   bool isGlobalRef(unsigned gid) const { return _ref[gid] == _globalRef; }
+   void setToGlobalRef(unsigned gid) const { _ref[gid] = _globalRef; }
+   void setGlobalRef() const { ++_globalRef; }
+   ull* getPattern(unsigned gid) { return &_pattern[gid * _simWords]; }
+   const ull* getPattern(unsigned gid) const { return &_pattern[gid * _simWords]; }
+   void initGates(size_t);
+   void addGate(unsigned, GateType, unsigned lineNo = 0);
+   void deleteGate(unsigned);
+   static AigGateV deadEdge() { return AigGateV::fromLit(UINT_MAX); }
+   size_t nFanouts(unsigned gid) const { return _foSize[gid] - _foDead[gid]; }
+   // the fanin slot of "gid" whose fanout edge is in slot "pos"
+   size_t faninSlot(unsigned gid, size_t pos) const {
+      return (_foPos[2 * gid] == pos ? 2 * gid : 2 * gid + 1);
+   }
+   void reserveFanouts(unsigned, size_t);
+   void moveFanouts(unsigned, size_t);
+   size_t addFanout(unsigned, const AigGateV&);
+   void detachFanin(unsigned, size_t);
+   void merge(const AigGateV&, unsigned);
+   void getFanouts(unsigned, IdList&) const;
+   void compactFanouts();
+   // compact once more than half of the slab is free ranges
+   void collectFanouts() {
+      if (2 * _fanoutSlab.numFreeElems() > _fanoutSlab.size())
+         compactFanouts();
+   }
+   string getTypeStr(unsigned) const;
+   string getName(unsigned) const;
+   void printGate(unsigned) const;
+   void reportFanin(unsigned, int, int, bool) const;
+   void reportFanout(unsigned, int, int, bool) const;
+
+   bool readAigDeltas(size_t&);
+   void linkFanins(bool);
+   void writeAig(ostream&, const IdList&, const IdList&, const GateVList&) const;
+   size_t numFecGrps() const { return _fecBegin.size() - 1; }
+   // the phase of "gid" in its FEC group
+   bool fecInv(unsigned gid) const { return _fecMembers[_fecPos[gid]].isInv(); }
+   void initFecGrps(const IdList&);
+   void clearFecGrps();
+   void initPatterns();
+   const vector<SimInstr>& getSimProgram(bool byLevel) const;
+   void simulate(size_t, size_t);
+   void writeSimLog(size_t);
+   void resimulate(const IdList&, size_t, IdList&);
+   void refineFecGrps(const vector<bool>&);
+   size_t refineFecGrp(unsigned, bool, size_t, FecRefineBuf&);
+   size_t refineBigFecGrp(unsigned, size_t, FecRefineBuf&);
+   size_t splitBuckets(size_t, FecRefineBuf&);
+   bool sameSig(const AigGateV&, const AigGateV&) const;
    void identifyFec();
-   void updateDfsList(GateList&) const;
-   void genProofModel(SatSolver*&, GateList&);
-   bool proofFec(SatSolver*&, CirGate*, CirGate*);
-   void mergeFec(vector<unsigned*>&);
+   void identifyFec(const IdList&);
+   void sortFecGrps();
+   void proofFecGrps(FraigSolver&, IdList&, IdList&, IdList&, unsigned, ostream*);
+   void genProofModel(FraigSolver&, unsigned);
+   lbool proofFec(FraigSolver&, unsigned, unsigned, int64, ostream&);
+   void mergeFec(vector<unsigned*>&, IdList&);
    void setFecGrpIdx();
 
 };
@@ -33,31 +33,27 @@ using namespace std;
 void
 CirMgr::sweep()
 {
-   CirGate::setGlobalRef();
-   for (auto& id : _POIds)
-      dfsTraversal(_totGates[id]);
+   setGlobalRef();
+   for (auto& id : getDfsList())
+      setToGlobalRef(id);
 
-   for (size_t i = 0; i < _totGates.size(); i++) {
-      if (_totGates[i] && !_totGates[i]->isGlobalRef() && _totGates[i]->getType() == AIG_GATE) {
-         cout << "Sweeping: AIG(" << _totGates[i]->getGid() << ") removed...\n";
+   for (size_t i = 0; i < _type.size(); i++) {
+      if (isGlobalRef(i))
+         continue;
+      if (_type[i] == AIG_GATE) {
+         cout << "Sweeping: AIG(" << i << ") removed...\n";
          _headerInfo[4]--;
 
-         for (size_t j = 0; j < 2; j++) {
-            AigGateV faninV = _totGates[i]->getFanin(j);
-            if (_totGates[faninV.getGid()]) {
-               _totGates[faninV.getGid()]->removeFanout(AigGateV(_totGates[i], faninV.isInv(), i));
-            }
-         }
-         delete _totGates[i];
-         _totGates[i] = 0;
+         for (size_t j = 0; j < 2; j++)
+            detachFanin(i, j);
+         deleteGate(i);
       }
-      else if (_totGates[i] && !_totGates[i]->isGlobalRef() && _totGates[i]->getType() == UNDEF_GATE) {
-         cout << "Sweeping: UNDEF(" << _totGates[i]->getGid() << ") removed...\n";
-         delete _totGates[i];
-         _totGates[i] = 0;
+      else if (_type[i] == UNDEF_GATE) {
+         cout << "Sweeping: UNDEF(" << i << ") removed...\n";
+         deleteGate(i);
       }
    }
-
+   collectFanouts();
 }
 
 // Recursively simplifying from POs;
@@ -66,63 +62,49 @@ CirMgr::sweep()
 void
 CirMgr::optimize()
 {
-   CirGate::setGlobalRef();
-   GateList dfsList;
-   dfsList.reserve(_headerInfo[0] + _headerInfo[3] + 1);
-   for (const auto& id : _POIds)
-      dfsTraversal(_totGates[id], dfsList);
+   const IdList& dfsList = getDfsList();
 
-   for (auto& g : dfsList) {
-      if (!g->isAig())
+   for (auto& id : dfsList) {
+      if (_type[id] != AIG_GATE)
          continue;
-      if (g->hasConstFanin(0)) {
-         _totGates[0]->merge(g, 0);
+      AigGateV in0 = getFanin(id, 0);
+      AigGateV in1 = getFanin(id, 1);
+      if (in0 == AigGateV(0) || in1 == AigGateV(0)) {
+         // constant 0 fanin
+         merge(AigGateV(0), id);
          _headerInfo[4]--; 
-         cout << "Simplifying: " << 0 << " merging " << g->getGid() << "...\n";
-         delete _totGates[g->getGid()];
-         _totGates[g->getGid()] = 0;
+         cout << "Simplifying: " << 0 << " merging " << id << "...\n";
+         deleteGate(id);
       }
-      else if (g->hasIdenticalFanin()) {
-         CirGate* mergeGate;
-         bool isInv = false;
-         mergeGate = g->getFanin(0).gate();
-         isInv = g->getFanin(0).isInv();
-         mergeGate->merge(g, isInv);
+      else if (in0 == in1) {
+         merge(in0, id);
          _headerInfo[4]--;
-         cout << "Simplifying: " << mergeGate->getGid() << " merging " << (isInv ? "!" : "") << g->getGid() << "...\n";
-         delete _totGates[g->getGid()];
-         _totGates[g->getGid()] = 0;
+         cout << "Simplifying: " << in0.getGid() << " merging " << (in0.isInv() ? "!" : "") << id << "...\n";
+         deleteGate(id);
       }
-      else if (g->hasInvertedFanin()) {
-         _totGates[0]->merge(g, 0);
+      else if (in0 == (in1 ^ true)) {
+         // inverted fanins
+         merge(AigGateV(0), id);
          _headerInfo[4]--;
-         cout << "Simplifying: " << 0 << " merging " << g->getGid() << "...\n";
-         delete _totGates[g->getGid()];
-         _totGates[g->getGid()] = 0;
+         cout << "Simplifying: " << 0 << " merging " << id << "...\n";
+         deleteGate(id);
       }
-      else if (g->hasConstFanin(1)) {
-         CirGate* mergeGate;
-         bool isInv = false;
-         for (size_t i = 0; i < 2; i++) {
-            if (g->getFanin(i) != AigGateV(_totGates[0], 1, 0)) {
-               mergeGate = g->getFanin(i).gate();
-               isInv = g->getFanin(i).isInv();
-            }
-         }
-         mergeGate->merge(g, isInv);
+      else if (in0 == AigGateV(0, 1) || in1 == AigGateV(0, 1)) {
+         // constant 1 fanin
+         AigGateV in = (in0 == AigGateV(0, 1) ? in1 : in0);
+         merge(in, id);
          _headerInfo[4]--;
-         cout << "Simplifying: " << mergeGate->getGid() << " merging " << (isInv ? "!" : "") << g->getGid() << "...\n";
-         delete _totGates[g->getGid()];
-         _totGates[g->getGid()] = 0;
+         cout << "Simplifying: " << in.getGid() << " merging " << (in.isInv() ? "!" : "") << id << "...\n";
+         deleteGate(id);
       }
    }
 
    for (size_t i = 0; i < _headerInfo[0] + 1; i++) {
-      if (_totGates[i] && _totGates[i]->getType() == UNDEF_GATE && _totGates[i]->getFanoutSize() == 0) {
-         delete _totGates[i];
-         _totGates[i] = 0;
-      }
+      if (isUndef(i) && nFanouts(i) == 0)
+         deleteGate(i);
    }
+   invalidateDfsList();
+   collectFanouts();
 }
 
 /***************************************************/
@@ -12,11 +12,19 @@
 #include <algorithm>
 #include <cassert>
 #include <cmath>
+#include <cctype>
+#include <cstring>
+#include <queue>
 #include "cirMgr.h"
 #include "cirGate.h"
 #include "util.h"
 #include "cirDef.h"
 
+#if defined(__GNUC__) && defined(__x86_64__)
+#define SIM_X86_KERNELS
+#include <immintrin.h>
+#endif
+
 using namespace std;
 
 // TODO: Keep "CirMgr::randimSim()" and "CirMgr::fileSim()" for cir cmd.
@@ -25,25 +33,241 @@ using namespace std;
 /*******************************/
 /*   Global variable and enum  */
 /*******************************/
-class SimValue
+// Reads a pattern file a big chunk at a time. next() returns the tokens
+// separated by white space, as "patternFile >> line" would; a token may
+// be longer than a chunk.
+class PatternReader
 {
 public:
-   SimValue(ull pattern) : _pattern(pattern) {}
-
-   size_t operator() () const { return (_pattern > ~_pattern ? _pattern : ~_pattern); }
+   PatternReader(istream& is) : _is(is), _buf(1 << 20), _begin(0), _end(0), _eof(false) {}
 
-   bool operator == (const SimValue& k) const {
-      return (k._pattern == _pattern) || (k._pattern == ~_pattern);
+   // the next token is [tok, tok + len); false at the end of the file
+   bool next(const char*& tok, size_t& len) {
+      while (true) {
+         while (_begin < _end && isspace((unsigned char)_buf[_begin]))
+            _begin++;
+         size_t i = _begin;
+         while (i < _end && !isspace((unsigned char)_buf[i]))
+            i++;
+         if (i < _end || (_eof && i > _begin)) {
+            tok = &_buf[_begin];
+            len = i - _begin;
+            _begin = i;
+            return true;
+         }
+         if (_eof)
+            return false;
+         // keep the partial token and read more
+         copy(_buf.begin() + _begin, _buf.begin() + _end, _buf.begin());
+         _end -= _begin;
+         _begin = 0;
+         if (_end == _buf.size())
+            _buf.resize(2 * _buf.size());
+         size_t n = _is.rdbuf()->sgetn(&_buf[_end], _buf.size() - _end);
+         _eof = (n == 0);
+         _end += n;
+      }
    }
 
 private:
-   ull _pattern;
+   istream&       _is;
+   vector<char>   _buf;
+   size_t         _begin;     // [_begin, _end) is not read yet
+   size_t         _end;
+   bool           _eof;
 };
 
-
 /**************************************/
 /*   Static varaibles and functions   */
 /**************************************/
+// Run the instructions [b, e) of a simulation program on the first "n"
+// words of each gate; the words of gate g are p[g * stride] on. The
+// complement of a fanin is an XOR with an all-1 mask, so the loop has no
+// branch but its own. The widest kernel the CPU supports is picked once at
+// startup.
+typedef void (*SimRunFunc)(const SimInstr*, const SimInstr*, ull*, size_t, size_t);
+
+static inline void
+simAndScalar(ull* dst, const ull* a, ull ma, const ull* b, ull mb, size_t n)
+{
+   for (size_t i = 0; i < n; i++)
+      dst[i] = (a[i] ^ ma) & (b[i] ^ mb);
+}
+
+static void
+simRunScalar(const SimInstr* b, const SimInstr* e, ull* p, size_t stride, size_t n)
+{
+   for (; b != e; ++b) {
+      unsigned l0 = b->in0.getLit(), l1 = b->in1.getLit();
+      simAndScalar(p + b->dst * stride, p + (l0 >> 1) * stride, -ull(l0 & 1),
+                   p + (l1 >> 1) * stride, -ull(l1 & 1), n);
+   }
+}
+
+#ifdef SIM_X86_KERNELS
+__attribute__((target("avx2"))) static inline void
+simAndAvx2(ull* dst, const ull* a, ull ma, const ull* b, ull mb, size_t n)
+{
+   size_t i = 0;
+   __m256i va = _mm256_set1_epi64x(ma), vb = _mm256_set1_epi64x(mb);
+   for (; i + 4 <= n; i += 4) {
+      __m256i x = _mm256_xor_si256(_mm256_loadu_si256((const __m256i*)(a + i)), va);
+      __m256i y = _mm256_xor_si256(_mm256_loadu_si256((const __m256i*)(b + i)), vb);
+      _mm256_storeu_si256((__m256i*)(dst + i), _mm256_and_si256(x, y));
+   }
+   for (; i < n; i++)
+      dst[i] = (a[i] ^ ma) & (b[i] ^ mb);
+}
+
+__attribute__((target("avx2"))) static void
+simRunAvx2(const SimInstr* b, const SimInstr* e, ull* p, size_t stride, size_t n)
+{
+   for (; b != e; ++b) {
+      unsigned l0 = b->in0.getLit(), l1 = b->in1.getLit();
+      simAndAvx2(p + b->dst * stride, p + (l0 >> 1) * stride, -ull(l0 & 1),
+                 p + (l1 >> 1) * stride, -ull(l1 & 1), n);
+   }
+}
+
+__attribute__((target("avx512f"))) static inline void
+simAndAvx512(ull* dst, const ull* a, ull ma, const ull* b, ull mb, size_t n)
+{
+   size_t i = 0;
+   __m512i va = _mm512_set1_epi64(ma), vb = _mm512_set1_epi64(mb);
+   for (; i + 8 <= n; i += 8) {
+      __m512i x = _mm512_xor_si512(_mm512_loadu_si512(a + i), va);
+      __m512i y = _mm512_xor_si512(_mm512_loadu_si512(b + i), vb);
+      _mm512_storeu_si512(dst + i, _mm512_and_si512(x, y));
+   }
+   for (; i < n; i++)
+      dst[i] = (a[i] ^ ma) & (b[i] ^ mb);
+}
+
+__attribute__((target("avx512f"))) static void
+simRunAvx512(const SimInstr* b, const SimInstr* e, ull* p, size_t stride, size_t n)
+{
+   for (; b != e; ++b) {
+      unsigned l0 = b->in0.getLit(), l1 = b->in1.getLit();
+      simAndAvx512(p + b->dst * stride, p + (l0 >> 1) * stride, -ull(l0 & 1),
+                   p + (l1 >> 1) * stride, -ull(l1 & 1), n);
+   }
+}
+#endif
+
+static SimRunFunc
+selectSimRun()
+{
+#ifdef SIM_X86_KERNELS
+   __builtin_cpu_init();
+   if (__builtin_cpu_supports("avx512f"))
+      return simRunAvx512;
+   if (__builtin_cpu_supports("avx2"))
+      return simRunAvx2;
+#endif
+   return simRunScalar;
+}
+
+static const SimRunFunc simRun = selectSimRun();
+
+// The signature of a FEC group member is its "n" simulation words, each
+// XOR'd with "mask" (0 or ~0) to apply its phase in the group.
+static size_t
+sigHash(const ull* p, size_t n, ull mask)
+{
+   size_t h = p[0] ^ mask;
+   for (size_t i = 1; i < n; i++)
+      h = (h ^ (p[i] ^ mask)) * 0x9e3779b97f4a7c15ULL;
+   return h;
+}
+
+// -1, 0 or 1 as the signature (p, mp) is before, equal to or after (q, mq)
+static int
+sigCompare(const ull* p, ull mp, const ull* q, ull mq, size_t n)
+{
+   for (size_t i = 0; i < n; i++) {
+      if ((p[i] ^ mp) != (q[i] ^ mq))
+         return (p[i] ^ mp) < (q[i] ^ mq) ? -1 : 1;
+   }
+   return 0;
+}
+
+// Set bit i % 64 of row[i / 64] if s[i] is '1', for i < n; return the
+// index of the first character other than '0' and '1', or n. Eight
+// characters at a time are checked and gathered into a byte.
+static size_t
+packRow(const char* s, size_t n, ull* row)
+{
+   size_t i = 0;
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+   for (; i + 8 <= n; i += 8) {
+      ull x;
+      memcpy(&x, s + i, 8);
+      x ^= 0x3030303030303030ULL;            // '0' -> 0, '1' -> 1
+      if (x & 0xfefefefefefefefeULL)
+         break;
+      row[i >> 6] |= ((x * 0x0102040810204080ULL) >> 56) << (i & 63);
+   }
+#endif
+   for (; i < n; i++) {
+      if (s[i] != '0' && s[i] != '1')
+         return i;
+      row[i >> 6] |= ull(s[i] - '0') << (i & 63);
+   }
+   return n;
+}
+
+// Transpose the 64x64 bit matrix "a": bit j of a[i] becomes bit i of a[j]
+static void
+transpose64(ull* a)
+{
+   ull m = 0x00000000ffffffffULL;
+   for (size_t j = 32; j != 0; j >>= 1, m ^= m << j) {
+      for (size_t k = 0; k < 64; k = (k + j + 1) & ~j) {
+         ull t = ((a[k] >> j) ^ a[k + j]) & m;
+         a[k + j] ^= t;
+         a[k] ^= t << j;
+      }
+   }
+}
+
+// Scratch of one task of CirMgr::refineFecGrps(), reused from group to
+// group. The keys of a group are bucketed by hash with open addressing;
+// table[] holds a bucket + 1, or 0 if the slot is empty.
+struct FecRefineBuf
+{
+   typedef pair<size_t, AigGateV> Key;   // (signature hash, member)
+
+   vector<Key>    keys;
+   IdList         bucket;     // the bucket of each key
+   IdList         first;      // the first key of each bucket
+   IdList         count;      // the keys in each bucket
+   vector<bool>   clash;      // a bucket with more than one signature
+   IdList         table;
+   size_t         mask;
+   GateVList      sorted;
+   IdList         ends;       // ends of the new groups in _fecMembers
+
+   void reset(size_t n) {
+      for (mask = 1; mask < 2 * n; mask <<= 1) ;
+      table.assign(mask--, 0);
+      keys.clear(); bucket.clear(); first.clear(); count.clear(); clash.clear();
+   }
+   // add key "i" to its bucket and return the bucket
+   size_t addKey(size_t i) {
+      size_t h = keys[i].first & mask;
+      while (table[h] && keys[first[table[h] - 1]].first != keys[i].first)
+         h = (h + 1) & mask;
+      if (!table[h]) {
+         first.push_back(i);
+         count.push_back(0);
+         clash.push_back(false);
+         table[h] = first.size();
+      }
+      bucket.push_back(table[h] - 1);
+      ++count[table[h] - 1];
+      return table[h] - 1;
+   }
+};
 
 /************************************************/
 /*   Public member functions about Simulation   */
@@ -51,108 +275,141 @@ private:
 void
 CirMgr::randomSim()
 {
-   GateList dfsList;
-   dfsList.reserve(_headerInfo[0] + _headerInfo[3] + 1);
-   updateDfsList(dfsList);
+   const IdList& dfsList = getDfsList();
 
    if (!_initFec) {
       initFecGrps(dfsList);
       _initFec = true;
    }
+   initPatterns();
    
    size_t limit = log(dfsList.size() + 1) * 5;
    size_t failTimes = 0;
    size_t count = 0;
 
+   // PI i takes its words from stream i / 64, so the patterns of a seed
+   // do not depend on the number of threads
+   const size_t nBlocks = (_PIIds.size() + 63) >> 6;
+   while (_simRng.size() < nBlocks) {
+      RandomWordGen rng = _simRng.back();
+      rng.jump();
+      _simRng.push_back(rng);
+   }
+   auto fillBlock = [this](size_t b) {
+      for (size_t i = 64 * b; i < _PIIds.size() && i < 64 * (b + 1); i++)
+         _simRng[b].fill(getPattern(_PIIds[i]), _simWords);
+   };
+
    while (failTimes < limit) {
       count++;
-      size_t oldFecGrpSize = _fecGrps.size();
-      for (const auto& id : _PIIds) {
-         _totGates[id]->setPattern(((size_t(rnGen(INT_MAX)) << 32) | size_t(rnGen(INT_MAX))));
-      }
-      simulate(dfsList, 64);
+      size_t oldFecGrpSize = numFecGrps();
+      _simPool.run(nBlocks, fillBlock);
+      simulate(_simWords, 64 * _simWords);
       identifyFec();
-      cout << "\rTotal #FEC Group = " << _fecGrps.size() << flush;
-      if (_fecGrps.size() == 0)
+      cout << "\rTotal #FEC Group = " << numFecGrps() << flush;
+      if (numFecGrps() == 0)
          break;
 
-      if (oldFecGrpSize == _fecGrps.size())
+      if (oldFecGrpSize == numFecGrps())
          failTimes++;
       else 
          failTimes = 0;
    }
+   _lastWord = _simWords - 1;
 
-   cout << "\r" << count * 64 << " patterns simulated.\n";
+   cout << "\r" << count * 64 * _simWords << " patterns simulated.\n";
 
-   for (auto& fecGrp : _fecGrps) 
-      sort(fecGrp->begin(), fecGrp->end());
-   sort(_fecGrps.begin(), _fecGrps.end(), [](IdList* a, IdList* b) { return a->front() < b->front(); });
-
-   setFecGrpIdx();
+   sortFecGrps();
 }
 
+// The patterns are simulated 64 * _simWords at a time; pattern k of a
+// pass is bit k % 64 of word k / 64.
 void
 CirMgr::fileSim(ifstream& patternFile)
 {
-   GateList dfsList;
-   dfsList.reserve(_headerInfo[0] + _headerInfo[3] + 1);
-   updateDfsList(dfsList);
+   const IdList& dfsList = getDfsList();
 
    if (!_initFec)
       initFecGrps(dfsList);
+   initPatterns();
 
-   string line = "";
+   const size_t nWords = _simWords;
+   const size_t passSize = 64 * nWords;
+   const size_t nPIs = _PIIds.size();
+   const size_t nRowWords = (nPIs + 63) >> 6;
    size_t nPat = 0;
    bool error = false;
-   vector<ull> pat(_PIIds.size(), 0);
-   while (patternFile >> line) {
-      if (line.empty())
-         continue;
+   vector<ull> pat(nPIs * nWords, 0);  // word w of PI i at i * nWords + w
+   // the patterns of a word are packed as rows (pattern k % 64 at
+   // k % 64 * nRowWords), then transposed 64 PIs at a time into "pat"
+   vector<ull> rows(64 * nRowWords, 0);
+   auto flushRows = [&](size_t w) {
+      ull a[64];
+      for (size_t j = 0; j < nRowWords; j++) {
+         for (size_t r = 0; r < 64; r++)
+            a[r] = rows[r * nRowWords + j];
+         transpose64(a);
+         for (size_t i = 64 * j; i < nPIs && i < 64 * (j + 1); i++)
+            pat[i * nWords + w] = a[i - 64 * j];
+      }
+      fill(rows.begin(), rows.end(), 0);
+   };
+   PatternReader reader(patternFile);
+   const char* tok;
+   size_t len;
+   while (reader.next(tok, len)) {
       nPat++;
-      if (line.length() != _PIIds.size()) {
-         cerr << "\nError: Pattern(" << line << ") length(" << line.length() << ") does not match the number of inputs(" << _PIIds.size() << ") in a circuit!!\n";
-         nPat = (nPat >> 6) << 6;
+      if (len != nPIs) {
+         cerr << "\nError: Pattern(" << string(tok, len) << ") length(" << len << ") does not match the number of inputs(" << nPIs << ") in a circuit!!\n";
          error = true;
          break;
       }
-      for (size_t i = 0; i < _PIIds.size(); i++) {
-         if (line[i] != '0' && line[i] != '1') {
-            cerr << "\nError: Pattern(" << line << ") contains a non-0/1 character(\'"<< line[i] << "\').\n";
-            nPat = (nPat >> 6) << 6;
-            error = true;
-            break;
-         }
-         if (line[i] == '1')
-            pat[i] |= ull(1) << ((nPat & 63) - 1);
-      }
-      if (error)
+      size_t k = (nPat - 1) % passSize;
+      size_t bad = packRow(tok, len, &rows[(k & 63) * nRowWords]);
+      if (bad < len) {
+         cerr << "\nError: Pattern(" << string(tok, len) << ") contains a non-0/1 character(\'"<< tok[bad] << "\').\n";
+         error = true;
          break;
-      if ((nPat & 63) == 0) {
-         for (size_t i = 0; i < _PIIds.size(); i++) 
-            _totGates[_PIIds[i]]->setPattern(pat[i]);
+      }
+      if ((k & 63) == 63)
+         flushRows(k >> 6);
+      if (nPat % passSize == 0) {
+         for (size_t i = 0; i < nPIs; i++) 
+            copy(&pat[i * nWords], &pat[i * nWords] + nWords, getPattern(_PIIds[i]));
          fill(pat.begin(), pat.end(), 0);
-         simulate(dfsList, 64);
+         simulate(nWords, passSize);
          identifyFec();
-         cout << "\rTotal #FEC Group = " << _fecGrps.size() << flush;
+         _lastWord = nWords - 1;
+         cout << "\rTotal #FEC Group = " << numFecGrps() << flush;
       }
    }
+   // the word of a broken pattern is dropped below
+   if (!error && (nPat & 63))
+      flushRows((nPat % passSize) >> 6);
 
-   if (!_initFec && nPat == 0) {
-      for (auto& fecGrp : _fecGrps) {
-         delete fecGrp;
-         fecGrp = 0;
-      }
-      _fecGrps.clear();
+   // only the words before the broken pattern are simulated
+   size_t nSim = nPat;
+   if (error) {
+      nSim = ((nPat - 1) >> 6) << 6;
+      nPat = (nPat >> 6) << 6;
    }
 
-   if ((nPat & 63) != 0) {
+   if (!_initFec && nPat == 0)
+      clearFecGrps();
+
+   size_t rest = nSim % passSize;
+   if (rest != 0) {
+      // the words after the last pattern are 0
+      size_t used = (rest + 63) >> 6;
       for (size_t i = 0; i < _PIIds.size(); i++) {
-         _totGates[_PIIds[i]]->setPattern(pat[i]);
+         fill(&pat[i * nWords] + used, &pat[i * nWords] + nWords, 0);
+         copy(&pat[i * nWords], &pat[i * nWords] + nWords, getPattern(_PIIds[i]));
       } 
       fill(pat.begin(), pat.end(), 0);
-      simulate(dfsList, (nPat & 63));
+      simulate(nWords, rest);
       identifyFec();
-      cout << "\rTotal #FEC Group = " << _fecGrps.size() << flush;
+      _lastWord = used - 1;
+      cout << "\rTotal #FEC Group = " << numFecGrps() << flush;
    }
 
    if (nPat / 64)
@@ -160,89 +417,534 @@ CirMgr::fileSim(ifstream& patternFile)
 
    cout << "\r" << nPat << " patterns simulated.\n";
 
-   for (auto& fecGrp : _fecGrps) 
-      sort(fecGrp->begin(), fecGrp->end());
-   sort(_fecGrps.begin(), _fecGrps.end(), [](IdList* a, IdList* b) { return a->front() < b->front(); });
-
-   setFecGrpIdx();
+   sortFecGrps();
 }
 
 /*************************************************/
 /*   Private member functions about Simulation   */
 /*************************************************/
+// Groups left by a first simulation of fewer than 64 patterns (see
+// fileSim()) are refined further rather than started again.
+void
+CirMgr::initFecGrps(const IdList& dfsList)
+{
+   if (numFecGrps())
+      return;
+   _fecMembers.reserve(dfsList.size());
+   _fecMembers.push_back(AigGateV(0));
+   for (auto& id : dfsList) {
+      if (_type[id] == AIG_GATE)
+         _fecMembers.push_back(AigGateV(id));
+   }
+   _fecBegin.push_back(_fecMembers.size());
+   _freshFecGrp = 0;
+}
+
+void
+CirMgr::clearFecGrps()
+{
+   for (auto& gv : _fecMembers) {
+      if (gv != deadEdge())
+         _fecGrpIdx[gv.getGid()] = UINT_MAX;
+   }
+   _fecMembers.clear();
+   _fecBegin.assign(1, 0);
+   _freshFecGrp = UINT_MAX;
+}
+
 void
-CirMgr::initFecGrps(GateList& dfsList)
+CirMgr::initPatterns()
 {
-   IdList* newFecGrp = new IdList;
-   newFecGrp->reserve(dfsList.size());
-   newFecGrp->push_back(0);
-   for (auto& g : dfsList) {
-      if (g && g->getType() == AIG_GATE) {
-         newFecGrp->push_back(g->getGid());
+   if (_pattern.size() != _type.size() * _simWords)
+      _pattern.assign(_type.size() * _simWords, 0);
+}
+
+// The simulation program has an instruction for each AIG and PO of the
+// DFS list. It is kept until the DFS list is invalidated.
+// In DFS order (byLevel false), the fanins of a gate were mostly just
+// computed, which is best for the cache. By level, level l + 1 is
+// _simProg[_levelBegin[l]] up to _simProg[_levelBegin[l + 1]] and DFS
+// order within; the level of a gate is 1 + the highest level of its fanins
+// (PIs and CONST0 are level 0), so a level does not depend on itself.
+const vector<SimInstr>&
+CirMgr::getSimProgram(bool byLevel) const
+{
+   if (_simProgValid && _simProgByLevel == byLevel)
+      return _simProg;
+   const IdList& dfsList = getDfsList();
+   _simProg.clear();
+   _levelBegin.clear();
+   if (!byLevel) {
+      for (auto& id : dfsList) {
+         if (nFanins(id))
+            _simProg.push_back(SimInstr(id, getFanin(id, 0), getFanin(id, nFanins(id) - 1)));
       }
    }
-   _fecGrps.push_back(newFecGrp);
+   else {
+      IdList level(_type.size(), 0);
+      unsigned maxLevel = 0;
+      for (auto& id : dfsList) {
+         if (nFanins(id) == 0)
+            continue;
+         unsigned l = level[getFanin(id, 0).getGid()];
+         if (nFanins(id) == 2 && level[getFanin(id, 1).getGid()] > l)
+            l = level[getFanin(id, 1).getGid()];
+         level[id] = ++l;
+         if (l > maxLevel)
+            maxLevel = l;
+      }
+      _levelBegin.assign(maxLevel + 1, 0);
+      for (auto& id : dfsList) {
+         if (level[id])
+            ++_levelBegin[level[id]];
+      }
+      for (size_t l = 1; l <= maxLevel; l++)
+         _levelBegin[l] += _levelBegin[l - 1];
+      _simProg.assign(_levelBegin[maxLevel], SimInstr(0, AigGateV(), AigGateV()));
+      IdList next(_levelBegin.begin(), _levelBegin.end() - 1);
+      for (auto& id : dfsList) {
+         if (level[id])
+            _simProg[next[level[id] - 1]++] = SimInstr(id, getFanin(id, 0), getFanin(id, nFanins(id) - 1));
+      }
+   }
+   _simProgValid = true;
+   _simProgByLevel = byLevel;
+   return _simProg;
 }
 
+// Simulate the first "nWords" words of every gate from those of the PIs,
+// and log the first "nPatterns" patterns.
+// With more than one thread, the instructions of a level are split among
+// the threads, and the levels are done one by one. Every gate is computed
+// from the same fanin values either way, so the result does not depend on
+// the number of threads.
 void
-CirMgr::simulate(GateList& dfsList, size_t size)
+CirMgr::simulate(size_t nWords, size_t nPatterns)
 {
-   for (auto& g : dfsList) 
-      g->simulation();
-   if (_simLog) {
-      for (size_t i = 0; i < size; i++) {
-         for (auto& id : _PIIds) 
-            (*_simLog) << (_totGates[id]->getPattern() >> i & 1);
-         (*_simLog) << " ";
-         for (auto& id : _POIds) 
-            (*_simLog) << (_totGates[id]->getPattern() >> i & 1);
-         (*_simLog) << "\n";
+   size_t nThreads = _simPool.size();
+   const vector<SimInstr>& prog = getSimProgram(nThreads > 1);
+   const SimInstr* code = prog.data();
+   ull* p = _pattern.data();
+   if (nThreads == 1)
+      simRun(code, code + prog.size(), p, _simWords, nWords);
+   else {
+      size_t begin = 0;
+      for (auto& end : _levelBegin) {
+         size_t n = end - begin;
+         // about 1K gates a task at least, or the hand-off costs more
+         size_t nTasks = (n >> 10) < 4 * nThreads ? (n >> 10) : 4 * nThreads;
+         if (nTasks < 2)
+            simRun(code + begin, code + end, p, _simWords, nWords);
+         else {
+            _simPool.run(nTasks, [&](size_t t) {
+               simRun(code + begin + n * t / nTasks, code + begin + n * (t + 1) / nTasks,
+                      p, _simWords, nWords);
+            });
+         }
+         begin = end;
       }
    }
+   if (_simLog)
+      writeSimLog(nPatterns);
 }
 
+// Log the PI and PO values of the first "nPatterns" patterns, pattern k
+// being bit k % 64 of word k / 64. In text, a pattern is a line of its PI
+// values, a space and its PO values; the words are transposed 64 gates
+// at a time into rows and formatted 8 bits at a time into a buffer.
+// A binary log (see setSimLog()) starts with the line
+//    "simlog <#PIs> <#POs>"
+// then has, for each word of up to 64 patterns, a byte with the number
+// of patterns in the word and the word of each PI and then of each PO,
+// 8 bytes each, least significant byte first. Bits after the last
+// pattern are 0.
 void
-CirMgr::identifyFec()
+CirMgr::writeSimLog(size_t nPatterns)
 {
-   vector<IdList*> newFecGrps;
-   newFecGrps.reserve(_headerInfo[4]);
-   for (auto& fecGrp : _fecGrps) {
-      HashMap<SimValue, IdList*> fecGrpsMap(getHashSize(fecGrp->size()));
-      for (auto& id : (*fecGrp)) {
-         IdList* newFecGrp;
-         SimValue s(_totGates[id]->getPattern());
-         if (fecGrpsMap.query(s, newFecGrp)) {
-            newFecGrp->push_back(id);
+   static char digits[256][8];   // digits[v][i] is bit i of v, '0' or '1'
+   if (digits[0][0] == 0) {
+      for (size_t v = 0; v < 256; v++) {
+         for (size_t i = 0; i < 8; i++)
+            digits[v][i] = '0' + (v >> i & 1);
+      }
+   }
+   const size_t bufSize = 1 << 20;
+   string buf;
+   buf.reserve(bufSize + 64);
+   auto flush = [&]() {
+      _simLog->write(buf.data(), buf.size());
+      buf.clear();
+   };
+
+   if (_simLogBinary && !_simLogHeader) {
+      *_simLog << "simlog " << _PIIds.size() << " " << _POIds.size() << "\n";
+      _simLogHeader = true;
+   }
+   const size_t nIn = (_PIIds.size() + 63) >> 6, nOut = (_POIds.size() + 63) >> 6;
+   const size_t nRowWords = nIn + nOut;
+   vector<ull> rows(64 * nRowWords);   // word j of pattern b at b * nRowWords + j
+   // transpose word "w" of "ids" into the rows from word "j" on
+   auto toRows = [&](const IdList& ids, size_t w, size_t j) {
+      ull a[64];
+      for (size_t first = 0; first < ids.size(); first += 64, j++) {
+         for (size_t r = 0; r < 64; r++)
+            a[r] = (first + r < ids.size() ? getPattern(ids[first + r])[w] : 0);
+         transpose64(a);
+         for (size_t b = 0; b < 64; b++)
+            rows[b * nRowWords + j] = a[b];
+      }
+   };
+   // the first "n" bits of "row" as digits
+   auto putBits = [&](const ull* row, size_t n) {
+      for (size_t i = 0; i < n; i += 8) {
+         unsigned char v = row[i >> 6] >> (i & 63);
+         buf.append(digits[v], n - i < 8 ? n - i : 8);
+      }
+   };
+   for (size_t w = 0; 64 * w < nPatterns; w++) {
+      size_t nb = (nPatterns - 64 * w < 64 ? nPatterns - 64 * w : 64);
+      if (_simLogBinary) {
+         ull mask = (nb == 64 ? ~ull(0) : (ull(1) << nb) - 1);
+         buf += char(nb);
+         for (const IdList* ids : { &_PIIds, &_POIds }) {
+            for (auto& id : *ids) {
+               ull x = getPattern(id)[w] & mask;
+               for (size_t i = 0; i < 8; i++)
+                  buf += char(x >> (8 * i));
+            }
          }
-         else {
-            newFecGrp = new IdList(1, id);
-            fecGrpsMap.insert(_totGates[id]->getPattern(), newFecGrp);
+         if (buf.size() >= bufSize)
+            flush();
+         continue;
+      }
+      toRows(_PIIds, w, 0);
+      toRows(_POIds, w, nIn);
+      for (size_t b = 0; b < nb; b++) {
+         putBits(&rows[b * nRowWords], _PIIds.size());
+         buf += ' ';
+         putBits(&rows[b * nRowWords + nIn], _POIds.size());
+         buf += '\n';
+         if (buf.size() >= bufSize)
+            flush();
+      }
+   }
+   flush();
+}
+
+// Event-driven resimulation of the first "nWords" words. The gates in
+// "seeds" are recomputed, and then the fanouts of each gate whose words
+// changed, in DFS order, so that a gate is computed once, after its
+// fanins. The gates that changed are appended to "changed". Only gates in
+// the DFS list are resimulated.
+void
+CirMgr::resimulate(const IdList& seeds, size_t nWords, IdList& changed)
+{
+   typedef pair<unsigned, unsigned> Event;   // (DFS position, gate ID)
+   getDfsList();
+   priority_queue<Event, vector<Event>, greater<Event> > events;
+   setGlobalRef();
+   auto schedule = [&](unsigned id) {
+      if (_dfsPos[id] != UINT_MAX && !isGlobalRef(id)) {
+         setToGlobalRef(id);
+         events.push(Event(_dfsPos[id], id));
+      }
+   };
+   for (auto& id : seeds)
+      schedule(id);
+
+   vector<ull> old(nWords);
+   IdList fanouts;
+   while (!events.empty()) {
+      unsigned id = events.top().second;
+      events.pop();
+      if (nFanins(id) == 0)
+         continue;
+      ull* w = getPattern(id);
+      copy(w, w + nWords, old.begin());
+      SimInstr instr(id, getFanin(id, 0), getFanin(id, nFanins(id) - 1));
+      simRun(&instr, &instr + 1, _pattern.data(), _simWords, nWords);
+      if (equal(w, w + nWords, old.begin()))
+         continue;
+      changed.push_back(id);
+      fanouts.clear();
+      getFanouts(id, fanouts);
+      for (auto& fo : fanouts)
+         schedule(fo);
+   }
+}
+
+// Partition refinement: the members of each group to refine are
+// bucketed by the hashes of their signatures, and every run of two or
+// more equal signatures becomes a group; members and new groups keep the
+// order of the members. The signatures themselves are only compared
+// within a bucket. Members keep their phases, so two gates stay together
+// only if they matched in the same phase on every pattern so far. The
+// members of a new group (see initFecGrps()) have no phases yet; a member
+// gets inverted if the MSB of its first word is 0.
+// The groups are rewritten in place in _fecMembers; dead members and
+// groups of one are dropped from all groups, refined or not. The cost is
+// in the number of members, not of gates.
+// With more than one thread (see setSimThreads()), runs of small groups
+// are refined in parallel, each run in its own range of _fecMembers, and
+// a big group is hashed and checked in parallel pieces. The result is
+// the same as with one thread.
+void
+CirMgr::refineFecGrps(const vector<bool>& touched)
+{
+   size_t nThreads = _simPool.size();
+   size_t nGrps = numFecGrps();
+   // about 1K members a task at least, or the hand-off costs more
+   size_t grain = _fecMembers.size() / (4 * nThreads);
+   if (nThreads == 1)
+      grain = SIZE_MAX;
+   else if (grain < 1024)
+      grain = 1024;
+   // task t refines the groups from taskBegin[t] to taskBegin[t + 1]; a
+   // big group is a task of its own and is split further
+   IdList taskBegin(1, 0);
+   vector<bool> bigTask;
+   for (size_t c = 0, n = 0; c < nGrps; c++) {
+      size_t size = _fecBegin[c + 1] - _fecBegin[c];
+      if (touched[c] && size >= grain) {
+         if (c > taskBegin.back()) {
+            taskBegin.push_back(c);
+            bigTask.push_back(false);
          }
+         taskBegin.push_back(c + 1);
+         bigTask.push_back(true);
+         n = 0;
+      }
+      else if ((n += size) >= grain) {
+         taskBegin.push_back(c + 1);
+         bigTask.push_back(false);
+         n = 0;
       }
+   }
+   if (taskBegin.back() < nGrps) {
+      taskBegin.push_back(nGrps);
+      bigTask.push_back(false);
+   }
 
-      for (HashMap<SimValue, IdList*>::iterator it = fecGrpsMap.begin(); it != fecGrpsMap.end(); it++) {
-         if ((*it).second->size() > 1) 
-            newFecGrps.push_back((*it).second);
-         else 
-            delete (*it).second;
+   size_t nTasks = bigTask.size();
+   vector<FecRefineBuf> bufs(nTasks);
+   IdList taskEnd(nTasks);
+   auto refineTask = [&](size_t t) {
+      size_t w = _fecBegin[taskBegin[t]];
+      for (size_t c = taskBegin[t]; c < taskBegin[t + 1]; c++)
+         w = (bigTask[t] ? refineBigFecGrp(c, w, bufs[t]) : refineFecGrp(c, touched[c], w, bufs[t]));
+      taskEnd[t] = w;
+   };
+   IdList smallTasks;
+   for (size_t t = 0; t < nTasks; t++) {
+      if (!bigTask[t])
+         smallTasks.push_back(t);
+   }
+   _simPool.run(smallTasks.size(), [&](size_t i) { refineTask(smallTasks[i]); });
+   for (size_t t = 0; t < nTasks; t++) {
+      if (bigTask[t])
+         refineTask(t);
+   }
+
+   // move the new groups of each task down, in order
+   size_t w = 0;
+   IdList newBegin(1, 0);
+   for (size_t t = 0; t < nTasks; t++) {
+      size_t b = _fecBegin[taskBegin[t]];
+      for (auto& end : bufs[t].ends)
+         newBegin.push_back(end - b + w);
+      for (size_t i = b; i < taskEnd[t]; i++)
+         _fecMembers[w++] = _fecMembers[i];
+   }
+   _fecMembers.resize(w);
+   _fecBegin.swap(newBegin);
+   _freshFecGrp = UINT_MAX;
+   setFecGrpIdx();
+}
+
+// Refine group "c" into the slots from "w" on (w <= _fecBegin[c]); return
+// the end of the new groups. The ends of the new groups are appended to
+// buf.ends, and _fecGrpIdx of the members is reset.
+size_t
+CirMgr::refineFecGrp(unsigned c, bool touched, size_t w, FecRefineBuf& buf)
+{
+   size_t b = _fecBegin[c], e = _fecBegin[c + 1];
+   if (!touched) {
+      size_t w0 = w;
+      for (size_t i = b; i < e; i++) {
+         if (_fecMembers[i] != deadEdge())
+            _fecMembers[w++] = _fecMembers[i];
       }
+      if (w - w0 > 1)
+         buf.ends.push_back(w);
+      else if (w > w0)
+         _fecGrpIdx[_fecMembers[--w].getGid()] = UINT_MAX;
+      return w;
    }
-   _fecGrps.swap(newFecGrps);
-   for (auto& fecGrp : newFecGrps) {
-      if (fecGrp)
-         delete fecGrp;
+   // a member is checked against the first one of its bucket while its
+   // words are still in cache
+   buf.reset(e - b);
+   for (size_t i = b; i < e; i++) {
+      AigGateV gv = _fecMembers[i];
+      if (gv == deadEdge())
+         continue;
+      unsigned id = gv.getGid();
+      _fecGrpIdx[id] = UINT_MAX;
+      const ull* p = getPattern(id);
+      bool inv = (c == _freshFecGrp ? !(p[0] >> 63) : gv.isInv());
+      buf.keys.push_back(FecRefineBuf::Key(sigHash(p, _simWords, -ull(inv)), AigGateV(id, inv)));
+      size_t k = buf.addKey(buf.keys.size() - 1);
+      if (buf.first[k] != buf.keys.size() - 1 && !buf.clash[k] &&
+          !sameSig(buf.keys[buf.first[k]].second, buf.keys.back().second))
+         buf.clash[k] = true;
+   }
+   return splitBuckets(w, buf);
+}
+
+// refineFecGrp() for a big group, which is hashed and checked against
+// the bucket heads in parallel pieces
+size_t
+CirMgr::refineBigFecGrp(unsigned c, size_t w, FecRefineBuf& buf)
+{
+   size_t b = _fecBegin[c], e = _fecBegin[c + 1];
+   buf.reset(e - b);
+   for (size_t i = b; i < e; i++) {
+      AigGateV gv = _fecMembers[i];
+      if (gv == deadEdge())
+         continue;
+      _fecGrpIdx[gv.getGid()] = UINT_MAX;
+      buf.keys.push_back(FecRefineBuf::Key(0, gv));
+   }
+   size_t n = buf.keys.size();
+   size_t nTasks = 4 * _simPool.size();
+   bool fresh = (c == _freshFecGrp);
+   _simPool.run(nTasks, [&](size_t t) {
+      for (size_t i = n * t / nTasks; i < n * (t + 1) / nTasks; i++) {
+         unsigned id = buf.keys[i].second.getGid();
+         const ull* p = getPattern(id);
+         bool inv = (fresh ? !(p[0] >> 63) : buf.keys[i].second.isInv());
+         buf.keys[i] = FecRefineBuf::Key(sigHash(p, _simWords, -ull(inv)), AigGateV(id, inv));
+      }
+   });
+   for (size_t i = 0; i < n; i++)
+      buf.addKey(i);
+   vector<IdList> clashes(nTasks);
+   _simPool.run(nTasks, [&](size_t t) {
+      for (size_t i = n * t / nTasks; i < n * (t + 1) / nTasks; i++) {
+         size_t k = buf.bucket[i];
+         if (buf.first[k] != i && !sameSig(buf.keys[buf.first[k]].second, buf.keys[i].second))
+            clashes[t].push_back(k);
+      }
+   });
+   for (auto& list : clashes) {
+      for (auto& k : list)
+         buf.clash[k] = true;
+   }
+   return splitBuckets(w, buf);
+}
+
+bool
+CirMgr::sameSig(const AigGateV& a, const AigGateV& b) const
+{
+   return sigCompare(getPattern(a.getGid()), -ull(a.isInv()),
+                     getPattern(b.getGid()), -ull(b.isInv()), _simWords) == 0;
+}
+
+// Write the buckets of buf.keys as new groups from slot "w" on, sorting a
+// bucket by the signatures on a hash collision; return the end
+size_t
+CirMgr::splitBuckets(size_t w, FecRefineBuf& buf)
+{
+   IdList& count = buf.count;
+   if (count.size() == buf.keys.size())
+      return w;
+   for (size_t k = 0, sum = 0; k < count.size(); k++) {
+      size_t size = count[k];
+      count[k] = sum;
+      sum += size;
+   }
+   GateVList& sorted = buf.sorted;
+   sorted.resize(buf.keys.size());
+   for (size_t i = 0; i < buf.keys.size(); i++)
+      sorted[count[buf.bucket[i]]++] = buf.keys[i].second;
+   // count[k] is now the end of bucket k
+   auto sigLess = [this](const AigGateV& x, const AigGateV& y) {
+      return sigCompare(getPattern(x.getGid()), -ull(x.isInv()),
+                        getPattern(y.getGid()), -ull(y.isInv()), _simWords) < 0;
+   };
+   for (size_t k = 0, r = 0; k < count.size(); r = count[k++]) {
+      size_t t = count[k];
+      if (buf.clash[k])
+         stable_sort(sorted.begin() + r, sorted.begin() + t, sigLess);
+      for (size_t i = r, j; i < t; i = j) {
+         for (j = i + 1; j < t && (!buf.clash[k] || sameSig(sorted[i], sorted[j])); j++) ;
+         if (j - i < 2)
+            continue;
+         for (size_t m = i; m < j; m++)
+            _fecMembers[w++] = sorted[m];
+         buf.ends.push_back(w);
+      }
    }
+   return w;
 }
 
 void
-CirMgr::setFecGrpIdx() 
+CirMgr::identifyFec()
+{
+   refineFecGrps(vector<bool>(numFecGrps(), true));
+}
+
+// Only the groups with a gate in "changed" are split; the others only
+// lose their dead members (see fraig()).
+void
+CirMgr::identifyFec(const IdList& changed)
+{
+   vector<bool> touched(numFecGrps(), false);
+   for (auto& id : changed) {
+      if (_fecGrpIdx[id] < numFecGrps())
+         touched[_fecGrpIdx[id]] = true;
+   }
+   refineFecGrps(touched);
+}
+
+// Sort the members of each group, and the groups by their first members
+void
+CirMgr::sortFecGrps()
 {
-   for (auto& g : _totGates) {
-      if (g)
-         g->setFecGrpIdx(UINT_MAX);
+   IdList order(numFecGrps());
+   for (size_t c = 0; c < order.size(); c++) {
+      order[c] = c;
+      sort(_fecMembers.begin() + _fecBegin[c], _fecMembers.begin() + _fecBegin[c + 1]);
    }
-   for (size_t i = 0; i < _fecGrps.size(); i++) {
-      for (auto& id : (*(_fecGrps[i]))) 
-         _totGates[id]->setFecGrpIdx(i);
+   sort(order.begin(), order.end(), [this](unsigned x, unsigned y) {
+      return _fecMembers[_fecBegin[x]] < _fecMembers[_fecBegin[y]];
+   });
+   GateVList members;
+   members.reserve(_fecMembers.size());
+   IdList begin(1, 0);
+   for (auto& c : order) {
+      members.insert(members.end(), _fecMembers.begin() + _fecBegin[c], _fecMembers.begin() + _fecBegin[c + 1]);
+      begin.push_back(members.size());
    }
-}
\ No newline at end of file
+   _fecMembers.swap(members);
+   _fecBegin.swap(begin);
+   setFecGrpIdx();
+}
+
+// Index the members of all groups; the cost is in the number of members
+void
+CirMgr::setFecGrpIdx() 
+{
+   size_t nGrps = numFecGrps();
+   size_t nThreads = _simPool.size();
+   size_t nTasks = (_fecMembers.size() >> 10) < 4 * nThreads ? (_fecMembers.size() >> 10) : 4 * nThreads;
+   if (nThreads == 1 || nTasks == 0)
+      nTasks = 1;
+   _simPool.run(nTasks, [&](size_t t) {
+      for (size_t c = nGrps * t / nTasks; c < nGrps * (t + 1) / nTasks; c++) {
+         for (size_t i = _fecBegin[c]; i < _fecBegin[c + 1]; i++) {
+            _fecGrpIdx[_fecMembers[i].getGid()] = c;
+            _fecPos[_fecMembers[i].getGid()] = i;
+         }
+      }
+   });
+}
@@ -678,8 +678,8 @@ lbool Solver::search(int nof_conflicts, int nof_learnts, const SearchParams& par
         }else{
             // NO CONFLICT
 
-            if (nof_conflicts >= 0 && conflictC >= nof_conflicts){
-                // Reached bound on number of conflicts:
+            if ((nof_conflicts >= 0 && conflictC >= nof_conflicts) || !withinBudget()){
+                // Reached bound on number of conflicts (or out of budget):
                 progress_estimate = progressEstimate();
                 cancelUntil(root_level);
                 return l_Undef; }
@@ -745,21 +745,22 @@ void Solver::claRescaleActivity()
 
 /*_________________________________________________________________________________________________
 |
-|  solve : (assumps : const vec<Lit>&)  ->  [bool]
+|  solveLimited : (assumps : const vec<Lit>&)  ->  [lbool]
 |  
 |  Description:
-|    Top-level solve. If using assumptions (non-empty 'assumps' vector), you must call
-|    'simplifyDB()' first to see that no top-level conflict is present (which would put the solver
-|    in an undefined state).
+|    Top-level solve. Gives up with 'l_Undef' once a budget set by 'setConfBudget()' or
+|    'setPropBudget()' is used up; 'solve()' is the same without budgets. If using assumptions
+|    (non-empty 'assumps' vector), you must call 'simplifyDB()' first to see that no top-level
+|    conflict is present (which would put the solver in an undefined state).
 |  
 |  Input:
 |    A list of assumptions (unit clauses coded as literals). Pre-condition: The assumptions must
 |    not contain both 'x' and '~x' for any variable 'x'.
 |________________________________________________________________________________________________@*/
-bool Solver::solve(const vec<Lit>& assumps)
+lbool Solver::solveLimited(const vec<Lit>& assumps)
 {
     simplifyDB();
-    if (!ok) return false;
+    if (!ok) return l_False;
 
     SearchParams    params(default_params);
     double  nof_conflicts = 100;
@@ -782,12 +783,12 @@ bool Solver::solve(const vec<Lit>& assumps)
                 if (proof != NULL) conflict_id = unit_id[var(p)];
             }
             cancelUntil(0);
-            return false; }
+            return l_False; }
         Clause* confl = propagate();
         if (confl != NULL){
             analyzeFinal(confl), assert(conflict.size() > 0);
             cancelUntil(0);
-            return false; }
+            return l_False; }
     }
     assert(root_level == decisionLevel());
 
@@ -803,7 +804,7 @@ bool Solver::solve(const vec<Lit>& assumps)
         reportf("===================================\n");
     }
 
-    while (status == l_Undef){
+    while (status == l_Undef && withinBudget()){
         if (verbosity >= 1){
             printStats();
             reportf("| %9d | %7d %8d | %7d %7d %8d %7.1f | %6.3f %% |\n",
@@ -826,7 +827,7 @@ bool Solver::solve(const vec<Lit>& assumps)
     }
 
     cancelUntil(0);
-    return status == l_True;
+    return status;
 }
 
 void Solver::printStats()
@@ -73,6 +73,8 @@ protected:
     int                 qhead;            // Head of queue (as index into the trail -- no more explicit propagation queue in MiniSat).
     int                 simpDB_assigns;   // Number of top-level assignments since last execution of 'simplifyDB()'.
     int64               simpDB_props;     // Remaining number of propagations that must be made before next execution of 'simplifyDB()'.
+    int64               conflict_budget;    // 'stats.conflicts' at which 'solveLimited()' gives up, or -1 for no limit.
+    int64               propagation_budget; // 'stats.propagations' at which 'solveLimited()' gives up, or -1 for no limit.
 
     // Temporaries (to reduce allocation overhead). Each variable is prefixed by the method in which is used:
     //
@@ -132,6 +134,8 @@ public:
              , qhead            (0)
              , simpDB_assigns   (0)
              , simpDB_props     (0)
+             , conflict_budget  (-1)
+             , propagation_budget(-1)
              , default_params   (SearchParams(0.95, 0.999, 0.02))
              , expensive_ccmin  (2)
              , proof            (NULL)
@@ -190,8 +194,18 @@ public:
     //
     bool    okay() { return ok; }       // FALSE means solver is in an conflicting state (must never be used again!)
     void    simplifyDB();
-    bool    solve(const vec<Lit>& assumps);
+    bool    solve(const vec<Lit>& assumps) { budgetOff(); return solveLimited(assumps) == l_True; }
     bool    solve() { vec<Lit> tmp; return solve(tmp); }
+    lbool   solveLimited(const vec<Lit>& assumps);     // 'l_Undef' if a budget ran out first.
+
+    // Resource limits for 'solveLimited()', counted from now:
+    //
+    void    setConfBudget(int64 x) { conflict_budget    = x < 0 ? -1 : stats.conflicts    + x; }
+    void    setPropBudget(int64 x) { propagation_budget = x < 0 ? -1 : stats.propagations + x; }
+    void    budgetOff()            { conflict_budget = propagation_budget = -1; }
+    bool    withinBudget() const {
+        return (conflict_budget    < 0 || stats.conflicts    < conflict_budget)
+            && (propagation_budget < 0 || stats.propagations < propagation_budget); }
 
     double      progress_estimate;  // Set by 'search()'.
     vec<lbool>  model;              // If problem is satisfiable, this vector contains the model (if any).
@@ -65,12 +65,42 @@ class SatSolver
          _solver->addClause(lits); lits.clear();
       }
 
+      // vf -> (va != vb), the half of addXorCNF() that a proof under the
+      // assumption vf needs; asserting vf false afterwards drops it.
+      // fa/fb = true if it is inverted
+      void addNeqCNF(Var vf, Var va, bool fa, Var vb, bool fb) {
+         vec<Lit> lits;
+         Lit lf = Lit(vf);
+         Lit la = fa? ~Lit(va): Lit(va);
+         Lit lb = fb? ~Lit(vb): Lit(vb);
+         lits.push( la); lits.push( lb); lits.push(~lf);
+         _solver->addClause(lits); lits.clear();
+         lits.push(~la); lits.push(~lb); lits.push(~lf);
+         _solver->addClause(lits); lits.clear();
+      }
+      // va == vb; fa/fb = true if it is inverted
+      void addEqCNF(Var va, bool fa, Var vb, bool fb) {
+         vec<Lit> lits;
+         Lit la = fa? ~Lit(va): Lit(va);
+         Lit lb = fb? ~Lit(vb): Lit(vb);
+         lits.push( la); lits.push(~lb);
+         _solver->addClause(lits); lits.clear();
+         lits.push(~la); lits.push( lb);
+         _solver->addClause(lits); lits.clear();
+      }
+
       // For incremental proof, use "assumeSolve()"
       void assumeRelease() { _assump.clear(); }
       void assumeProperty(Var prop, bool val) {
          _assump.push(val? Lit(prop): ~Lit(prop));
       }
       bool assumpSolve() { return _solver->solve(_assump); }
+      // Bounded proof: a budget < 0 is no limit, and l_Undef means that
+      // it ran out before an answer
+      void setBudget(int64 nConflicts, int64 nProps = -1) {
+         _solver->setConfBudget(nConflicts); _solver->setPropBudget(nProps);
+      }
+      lbool assumpSolveLimited() { return _solver->solveLimited(_assump); }
 
       // For one time proof, use "solve"
       void assertProperty(Var prop, bool val) {
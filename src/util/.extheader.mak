@@ -1,4 +1,4 @@
-util.d: ../../include/util.h ../../include/rnGen.h ../../include/myUsage.h ../../include/myHashMap.h 
+util.d: ../../include/util.h ../../include/rnGen.h ../../include/myUsage.h ../../include/myHashMap.h ../../include/myFileMap.h ../../include/myThreadPool.h ../../include/mySlabAlloc.h 
 ../../include/util.h: util.h
 	@rm -f ../../include/util.h
 	@ln -fs ../src/util/util.h ../../include/util.h
@@ -11,3 +11,12 @@ util.d: ../../include/util.h ../../include/rnGen.h ../../include/myUsage.h ../..
 ../../include/myHashMap.h: myHashMap.h
 	@rm -f ../../include/myHashMap.h
 	@ln -fs ../src/util/myHashMap.h ../../include/myHashMap.h
+../../include/myFileMap.h: myFileMap.h
+	@rm -f ../../include/myFileMap.h
+	@ln -fs ../src/util/myFileMap.h ../../include/myFileMap.h
+../../include/myThreadPool.h: myThreadPool.h
+	@rm -f ../../include/myThreadPool.h
+	@ln -fs ../src/util/myThreadPool.h ../../include/myThreadPool.h
+../../include/mySlabAlloc.h: mySlabAlloc.h
+	@rm -f ../../include/mySlabAlloc.h
+	@ln -fs ../src/util/mySlabAlloc.h ../../include/mySlabAlloc.h
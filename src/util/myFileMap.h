@@ -0,0 +1,98 @@
+/****************************************************************************
+  FileName     [ myFileMap.h ]
+  PackageName  [ util ]
+  Synopsis     [ Read-only memory-mapped view of a file ]
+  Author       [ Chung-Yang (Ric) Huang ]
+  Copyright    [ Copyleft(c) 2007-present LaDs(III), GIEE, NTU, Taiwan ]
+****************************************************************************/
+
+#ifndef MY_FILE_MAP_H
+#define MY_FILE_MAP_H
+
+#include <string>
+#include <cstdlib>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+using namespace std;
+
+// Map the whole file into memory so that parsers can tokenize it in place.
+// If the file cannot be mapped (e.g. a pipe), fall back to reading it into
+// a heap buffer. The contents are NOT null-terminated; use size().
+class MyFileMap
+{
+public:
+   MyFileMap() : _data(0), _size(0), _mapped(false) {}
+   ~MyFileMap() { close(); }
+
+   bool open(const string& fileName) {
+      close();
+      int fd = ::open(fileName.c_str(), O_RDONLY);
+      if (fd < 0) return false;
+      struct stat st;
+      if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode)) {
+         _size = st.st_size;
+         if (_size == 0) { ::close(fd); return true; }
+         void* p = mmap(0, _size, PROT_READ, MAP_PRIVATE, fd, 0);
+         if (p != MAP_FAILED) {
+            madvise(p, _size, MADV_SEQUENTIAL);
+            _data = (const char*)p;
+            _mapped = true;
+            ::close(fd);
+            return true;
+         }
+      }
+      bool ok = readAll(fd);
+      ::close(fd);
+      return ok;
+   }
+   void close() {
+      if (_mapped) munmap((void*)_data, _size);
+      else free((void*)_data);
+      _data = 0; _size = 0; _mapped = false;
+   }
+
+   // Drop the mapped pages before "p" from memory, e.g. once a parser is
+   // done with them; they are read back from the file if touched again.
+   void release(const char* p) {
+      if (!_mapped) return;
+      size_t page = sysconf(_SC_PAGESIZE);
+      size_t n = (p - _data) / page * page;
+      if (n) madvise((void*)_data, n, MADV_DONTNEED);
+   }
+
+   const char* data() const { return _data; }
+   size_t size() const { return _size; }
+
+private:
+   const char*   _data;
+   size_t        _size;
+   bool          _mapped;
+
+   bool readAll(int fd) {
+      char* buf = 0;
+      size_t cap = 0;
+      _size = 0;
+      while (true) {
+         if (_size == cap) {
+            cap = (cap ? cap * 2 : 1 << 16);
+            char* tmp = (char*)realloc(buf, cap);
+            if (!tmp) { free(buf); _size = 0; return false; }
+            buf = tmp;
+         }
+         ssize_t n = ::read(fd, buf + _size, cap - _size);
+         if (n < 0) { free(buf); _size = 0; return false; }
+         if (n == 0) break;
+         _size += n;
+      }
+      _data = buf;
+      return true;
+   }
+
+   MyFileMap(const MyFileMap&);             // not copyable
+   MyFileMap& operator = (const MyFileMap&);
+};
+
+#endif // MY_FILE_MAP_H
@@ -21,19 +21,19 @@ using namespace std;
 // To use HashMap ADT, you should define your own HashKey class.
 // It should at least overload the "()" and "==" operators.
 
+// Key for structural hashing: the two fanin literals of an AND gate.
+// They are kept in increasing order, so (a, b) and (b, a) are the same key.
 class HashKey
 {
 public:
-   HashKey(const size_t& in0, const size_t& in1) : _in0(in0), _in1(in1) {}
+   HashKey(unsigned in0, unsigned in1) : _in0(in0 < in1 ? in0 : in1), _in1(in0 < in1 ? in1 : in0) {}
 
-   size_t operator() () const { return _in0 & _in1; }
+   size_t operator() () const { return (size_t(_in1) << 32 | _in0) * 0x9e3779b97f4a7c15ULL >> 16; }
 
-   bool operator == (const HashKey& k) const { 
-      return (k._in0 == _in0 && k._in1 == _in1) || (k._in0 == _in1 && k._in1 == _in0); 
-   }
+   bool operator == (const HashKey& k) const { return k._in0 == _in0 && k._in1 == _in1; }
 
 private:
-   size_t _in0, _in1;
+   unsigned _in0, _in1;
 };
 
 template <class HashKey, class HashData>
@@ -131,7 +131,7 @@ public:
          if (!_buckets[i].empty())
             return iterator(_buckets, _numBuckets, i, 0);
       }
-      return iterator(); 
+      return end(); 
    }
    // Pass the end
    iterator end() const { return iterator(_buckets, _numBuckets, _numBuckets, 0); }
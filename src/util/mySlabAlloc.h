@@ -0,0 +1,103 @@
+/****************************************************************************
+  FileName     [ mySlabAlloc.h ]
+  PackageName  [ util ]
+  Synopsis     [ Define a slab allocator for many small arrays ]
+  Author       [ Chung-Yang (Ric) Huang ]
+  Copyright    [ Copyleft(c) 2007-present LaDs(III), GIEE, NTU, Taiwan ]
+****************************************************************************/
+
+#ifndef MY_SLAB_ALLOC_H
+#define MY_SLAB_ALLOC_H
+
+#include <vector>
+
+using namespace std;
+
+// All arrays are ranges of one pool and are addressed by their first
+// index, so a range stays valid when the pool grows (pointers do not).
+// A freed range is kept in the free list of its size class, i.e. class c
+// holds ranges of [2^c, 2^(c+1)) elements, and is handed out again to a
+// request that fits. release() gives everything back at once.
+template <class T>
+class MySlabAlloc
+{
+public:
+   MySlabAlloc() { resetCounters(); }
+
+   // Return the first index of a range of at least n elements; its real
+   // capacity is returned in "cap". Nothing is allocated for n == 0.
+   size_t alloc(size_t n, size_t& cap) {
+      cap = n;
+      if (n == 0) return 0;
+      ++_nAlloc;
+      size_t c = sizeClass(n);
+      if (c < _freeList.size() && !_freeList[c].empty() && _freeList[c].back().second >= n)
+         return reuse(c, cap);
+      // every range in class c + 1 is big enough
+      if (++c < _freeList.size() && !_freeList[c].empty())
+         return reuse(c, cap);
+      size_t i = _pool.size();
+      _pool.resize(i + n);
+      return i;
+   }
+   void free(size_t i, size_t cap) {
+      if (cap == 0) return;
+      ++_nFree;
+      size_t c = sizeClass(cap);
+      if (c >= _freeList.size()) _freeList.resize(c + 1);
+      _freeList[c].push_back(Range(i, cap));
+      _nFreeElems += cap;
+   }
+   void reserve(size_t n) { _pool.reserve(n); }
+   void swap(MySlabAlloc<T>& s) {
+      _pool.swap(s._pool);
+      _freeList.swap(s._freeList);
+      std::swap(_nFreeElems, s._nFreeElems);
+      std::swap(_nAlloc, s._nAlloc);
+      std::swap(_nFree, s._nFree);
+      std::swap(_nReuse, s._nReuse);
+   }
+   void release() {
+      vector<T>().swap(_pool);
+      vector<vector<Range> >().swap(_freeList);
+      resetCounters();
+   }
+
+   T& operator [] (size_t i) { return _pool[i]; }
+   const T& operator [] (size_t i) const { return _pool[i]; }
+
+   // Instrumentation
+   size_t size() const { return _pool.size(); }          // elements in use or free
+   size_t capacity() const { return _pool.capacity(); }
+   size_t numFreeElems() const { return _nFreeElems; }
+   size_t numAlloc() const { return _nAlloc; }
+   size_t numFree() const { return _nFree; }
+   size_t numReuse() const { return _nReuse; }
+
+private:
+   typedef pair<size_t, size_t> Range;   // (first index, capacity)
+
+   vector<T>                  _pool;
+   vector<vector<Range> >     _freeList;
+   size_t                     _nFreeElems;
+   size_t                     _nAlloc;
+   size_t                     _nFree;
+   size_t                     _nReuse;
+
+   static size_t sizeClass(size_t n) {
+      size_t c = 0;
+      while (n >>= 1) ++c;
+      return c;
+   }
+   size_t reuse(size_t c, size_t& cap) {
+      Range r = _freeList[c].back();
+      _freeList[c].pop_back();
+      ++_nReuse;
+      _nFreeElems -= r.second;
+      cap = r.second;
+      return r.first;
+   }
+   void resetCounters() { _nFreeElems = _nAlloc = _nFree = _nReuse = 0; }
+};
+
+#endif // MY_SLAB_ALLOC_H
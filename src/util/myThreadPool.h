@@ -0,0 +1,102 @@
+/****************************************************************************
+  FileName     [ myThreadPool.h ]
+  PackageName  [ util ]
+  Synopsis     [ Define a fixed-size pool of worker threads ]
+  Author       [ Chung-Yang (Ric) Huang ]
+  Copyright    [ Copyleft(c) 2007-present LaDs(III), GIEE, NTU, Taiwan ]
+****************************************************************************/
+
+#ifndef MY_THREAD_POOL_H
+#define MY_THREAD_POOL_H
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <functional>
+#include <condition_variable>
+
+using namespace std;
+
+// run(n, f) calls f(0) ... f(n-1) on the pool and returns when all calls
+// are done. Tasks are handed out one at a time, so n may (and for load
+// balance, should) be larger than the number of threads. The calling
+// thread works as well, so a pool of size 1 has no extra threads.
+class MyThreadPool
+{
+public:
+   MyThreadPool(size_t n = 1) : _job(0), _nTasks(0), _busy(0), _gen(0), _stop(false) { resize(n); }
+   ~MyThreadPool() { resize(1); }
+
+   size_t size() const { return _workers.size() + 1; }
+
+   void resize(size_t n) {
+      if (n == 0) n = 1;
+      if (n == size()) return;
+      {
+         lock_guard<mutex> lock(_mtx);
+         _stop = true;
+      }
+      _wakeCv.notify_all();
+      for (auto& t : _workers) t.join();
+      _workers.clear();
+      _stop = false;
+      for (size_t i = 1; i < n; ++i)
+         _workers.push_back(thread(&MyThreadPool::loop, this, _gen));
+   }
+
+   void run(size_t n, const function<void(size_t)>& f) {
+      if (_workers.empty() || n <= 1) {
+         for (size_t i = 0; i < n; ++i) f(i);
+         return;
+      }
+      {
+         lock_guard<mutex> lock(_mtx);
+         _job = &f;
+         _nTasks = n;
+         _next = 0;
+         _busy = _workers.size();
+         ++_gen;
+      }
+      _wakeCv.notify_all();
+      work();
+      unique_lock<mutex> lock(_mtx);
+      _doneCv.wait(lock, [this] { return _busy == 0; });
+      _job = 0;
+   }
+
+private:
+   vector<thread>                   _workers;
+   mutex                            _mtx;
+   condition_variable               _wakeCv;
+   condition_variable               _doneCv;
+   const function<void(size_t)>    *_job;
+   size_t                           _nTasks;
+   atomic<size_t>                   _next;
+   size_t                           _busy;
+   size_t                           _gen;
+   bool                             _stop;
+
+   void work() {
+      for (size_t i; (i = _next++) < _nTasks; )
+         (*_job)(i);
+   }
+   void loop(size_t seen) {
+      while (true) {
+         {
+            unique_lock<mutex> lock(_mtx);
+            _wakeCv.wait(lock, [&] { return _stop || _gen != seen; });
+            if (_stop) return;
+            seen = _gen;
+         }
+         work();
+         lock_guard<mutex> lock(_mtx);
+         if (--_busy == 0) _doneCv.notify_one();
+      }
+   }
+
+   MyThreadPool(const MyThreadPool&);            // not copyable
+   MyThreadPool& operator = (const MyThreadPool&);
+};
+
+#endif // MY_THREAD_POOL_H
@@ -26,5 +26,57 @@ class RandomNumGen
       }
 };
 
+// xoshiro256** by D. Blackman and S. Vigna, seeded through splitmix64.
+// It returns 64 random bits per call, and fill() writes whole arrays of
+// words. jump() moves 2^128 calls ahead, so the copies of one generator
+// jumped 0, 1, 2, ... times are independent streams, e.g. one per thread.
+class RandomWordGen
+{
+   public:
+      typedef unsigned long long Word;
+
+      RandomWordGen(Word seed = 0) { reseed(seed); }
+      void reseed(Word seed) {
+         for (int i = 0; i < 4; ++i) {
+            Word z = (seed += 0x9e3779b97f4a7c15ULL);
+            z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+            z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+            _s[i] = z ^ (z >> 31);
+         }
+      }
+      Word operator() () {
+         Word r = rotl(_s[1] * 5, 7) * 9;
+         Word t = _s[1] << 17;
+         _s[2] ^= _s[0];
+         _s[3] ^= _s[1];
+         _s[1] ^= _s[2];
+         _s[0] ^= _s[3];
+         _s[2] ^= t;
+         _s[3] = rotl(_s[3], 45);
+         return r;
+      }
+      void fill(Word* p, size_t n) {
+         for (size_t i = 0; i < n; ++i) p[i] = (*this)();
+      }
+      void jump() {
+         static const Word j[4] = { 0x180ec6d33cfd0abaULL, 0xd5a61266f0c9392cULL,
+                                    0xa9582618e03fc9aaULL, 0x39abdc4529b1661cULL };
+         Word s[4] = { 0, 0, 0, 0 };
+         for (int i = 0; i < 4; ++i) {
+            for (int b = 0; b < 64; ++b) {
+               if (j[i] >> b & 1)
+                  for (int k = 0; k < 4; ++k) s[k] ^= _s[k];
+               (*this)();
+            }
+         }
+         for (int k = 0; k < 4; ++k) _s[k] = s[k];
+      }
+
+   private:
+      Word _s[4];
+
+      static Word rotl(Word x, int k) { return (x << k) | (x >> (64 - k)); }
+};
+
 #endif // RN_GEN_H
 